@@ -0,0 +1,172 @@
+// Admission control and load shedding for many streams on one host.
+//
+// Every live stream needs `rtf` cores on average (decode CPU seconds per
+// second of audio), so N streams load the host's decode cores to
+// N * rtf / cores. The controller keeps a moving average of the measured
+// per-stream RTF, seeded from the warm-up, and derives from it the load, a
+// shedding level and the number of streams that still fit.
+//
+// Levels rise as the load crosses configurable fractions of the cores:
+//
+//   NORMAL         full service
+//   NO_PARTIALS    stop polling partial results
+//   COARSE_CHUNKS  also feed the decoder larger chunks (less per-call overhead)
+//   REFUSE_NEW     also refuse new streams; running ones keep their capacity
+//
+// A level is left only once the load has dropped `hysteresis` below its
+// threshold, so shedding (which lowers the measured RTF) does not flap.
+// admit() turns away a stream that would push the load to the refuse level.
+
+#ifndef ADMISSION_CONTROL_H
+#define ADMISSION_CONTROL_H
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <cstdio>
+
+enum class LoadLevel { NORMAL, NO_PARTIALS, COARSE_CHUNKS, REFUSE_NEW };
+
+inline const char* loadLevelName(LoadLevel level) {
+    switch (level) {
+        case LoadLevel::NORMAL: return "normal";
+        case LoadLevel::NO_PARTIALS: return "no-partials";
+        case LoadLevel::COARSE_CHUNKS: return "coarse-chunks";
+        case LoadLevel::REFUSE_NEW: return "refusing";
+    }
+    return "?";
+}
+
+// Load thresholds as fractions of the decode cores
+struct SheddingConfig {
+    double no_partials = 0.70;
+    double coarse_chunks = 0.85;
+    double refuse_new = 0.95;
+    double hysteresis = 0.05;
+    double rtf_smoothing = 0.1;   // weight of each new RTF sample
+};
+
+struct CapacitySnapshot {
+    unsigned long active;
+    double rtf;           // per stream
+    double load;          // fraction of the cores
+    double headroom;      // idle cores
+    LoadLevel level;
+    long free_streams;    // streams that can still be admitted
+    unsigned long admitted;
+    unsigned long refused;
+};
+
+class AdmissionController {
+private:
+    SheddingConfig config;
+    double cores;
+    mutable std::mutex mutex;
+    double rtf;
+    unsigned long active = 0;
+    unsigned long admitted = 0;
+    unsigned long refused = 0;
+    LoadLevel current = LoadLevel::NORMAL;
+
+    double threshold(LoadLevel level) const {
+        switch (level) {
+            case LoadLevel::NO_PARTIALS: return config.no_partials;
+            case LoadLevel::COARSE_CHUNKS: return config.coarse_chunks;
+            case LoadLevel::REFUSE_NEW: return config.refuse_new;
+            default: return 0.0;
+        }
+    }
+
+    double loadOf(unsigned long streams) const { return streams * rtf / cores; }
+
+    // Called with the lock held
+    void updateLevel() {
+        double load = loadOf(active);
+        int level = (int)current;
+        while (level < (int)LoadLevel::REFUSE_NEW && load >= threshold((LoadLevel)(level + 1))) level++;
+        while (level > (int)LoadLevel::NORMAL && load < threshold((LoadLevel)level) - config.hysteresis) level--;
+        current = (LoadLevel)level;
+    }
+
+public:
+    // initial_rtf: estimate until streams report, e.g. from the warm-up
+    AdmissionController(double decode_cores, double initial_rtf, const SheddingConfig& shedding = SheddingConfig())
+        : config(shedding), cores(decode_cores > 0 ? decode_cores : 1.0), rtf(initial_rtf) {}
+
+    // Replaces the RTF estimate, e.g. once the warm-up was measured
+    void seed(double initial_rtf) {
+        std::lock_guard<std::mutex> lock(mutex);
+        rtf = initial_rtf;
+    }
+
+    // Admits a new stream if it fits below the refuse threshold. A stream
+    // not admitted may retry; once it gives up, call refuse().
+    bool admit() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (current == LoadLevel::REFUSE_NEW || loadOf(active + 1) > config.refuse_new) return false;
+        active++;
+        admitted++;
+        updateLevel();
+        return true;
+    }
+
+    void refuse() {
+        std::lock_guard<std::mutex> lock(mutex);
+        refused++;
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (active > 0) active--;
+        updateLevel();
+    }
+
+    // A worker decoded `audio_seconds` of its streams in `cpu_seconds`
+    void recordDecode(double audio_seconds, double cpu_seconds) {
+        if (audio_seconds <= 0.0) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        double weight = std::min(1.0, config.rtf_smoothing * audio_seconds);
+        rtf += weight * (cpu_seconds / audio_seconds - rtf);
+        updateLevel();
+    }
+
+    LoadLevel level() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return current;
+    }
+
+    CapacitySnapshot snapshot() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        CapacitySnapshot s;
+        s.active = active;
+        s.rtf = rtf;
+        s.load = loadOf(active);
+        s.headroom = cores - active * rtf;
+        s.level = current;
+        long fit = rtf > 0 ? (long)std::floor(config.refuse_new * cores / rtf) : 0;
+        s.free_streams = current == LoadLevel::REFUSE_NEW ? 0 : std::max(0L, fit - (long)active);
+        s.admitted = admitted;
+        s.refused = refused;
+        return s;
+    }
+};
+
+// Writes the snapshot as one line of JSON, replacing the file atomically so
+// a load balancer polling it never reads half a line
+inline bool writeCapacityFile(const std::string& path, const CapacitySnapshot& s) {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp);
+        if (!out.is_open()) return false;
+        out << "{\"active\": " << s.active << ", \"free_streams\": " << s.free_streams
+            << ", \"load\": " << s.load << ", \"headroom_cores\": " << s.headroom
+            << ", \"rtf\": " << s.rtf << ", \"level\": \"" << loadLevelName(s.level)
+            << "\", \"admitted\": " << s.admitted << ", \"refused\": " << s.refused << "}" << std::endl;
+        if (!out.good()) return false;
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+#endif // ADMISSION_CONTROL_H
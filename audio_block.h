@@ -0,0 +1,197 @@
+// Reference-counted audio blocks from a fixed slab.
+//
+// A BlockPool allocates all its blocks and their sample storage up front.
+// allocate() takes a block off a lock-free free list and returns an
+// AudioBlockRef; copying the ref adds a reference, and when the last one
+// goes the block returns to the free list. No malloc or free after
+// construction, and no locks, so blocks can be allocated and released in
+// the audio callback.
+//
+// The producer fills a block through mutableBlock() and then publishes it;
+// every holder - queue, tee consumers, decoder, recent-audio history -
+// reads the same samples, so a block is written once and never copied.
+// Nothing may write to a block after it is published.
+
+#ifndef AUDIO_BLOCK_H
+#define AUDIO_BLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "stream_dsp.h"
+
+class BlockPool;
+
+struct AudioBlock {
+    uint32_t stream = 0;          // producer-defined stream index
+    uint64_t sequence = 0;        // block number within the stream
+    BlockResult result = BlockResult::SILENCE;
+    bool end_of_stream = false;   // no samples; the stream has ended
+    unsigned long frames = 0;
+    short* samples = nullptr;     // pool storage, maxFrames() long
+
+    // Pool bookkeeping
+    std::atomic<uint32_t> refs{0};
+    std::atomic<uint32_t> next_free{0};
+    uint32_t index = 0;
+    BlockPool* pool = nullptr;
+};
+
+// Intrusive reference to a pooled block. Copy adds a reference, move
+// transfers it.
+class AudioBlockRef {
+private:
+    AudioBlock* block = nullptr;
+
+    inline void drop();
+
+public:
+    AudioBlockRef() {}
+    explicit AudioBlockRef(AudioBlock* b) : block(b) {}   // adopts one reference
+    AudioBlockRef(const AudioBlockRef& other) : block(other.block) {
+        if (block) block->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    AudioBlockRef(AudioBlockRef&& other) noexcept : block(other.block) { other.block = nullptr; }
+    ~AudioBlockRef() { drop(); }
+
+    AudioBlockRef& operator=(const AudioBlockRef& other) {
+        if (other.block) other.block->refs.fetch_add(1, std::memory_order_relaxed);
+        drop();
+        block = other.block;
+        return *this;
+    }
+    AudioBlockRef& operator=(AudioBlockRef&& other) noexcept {
+        if (this != &other) {
+            drop();
+            block = other.block;
+            other.block = nullptr;
+        }
+        return *this;
+    }
+
+    void reset() { drop(); }
+
+    const AudioBlock* operator->() const { return block; }
+    const AudioBlock& operator*() const { return *block; }
+    explicit operator bool() const { return block != nullptr; }
+
+    // Producer only, before the block is shared
+    AudioBlock* mutableBlock() { return block; }
+};
+
+class BlockPool {
+private:
+    static const uint32_t NONE = 0xffffffffu;
+
+    std::unique_ptr<AudioBlock[]> blocks;
+    std::vector<short> storage;
+    size_t block_count;
+    size_t max_frames;
+    // Free list head: index in the low 32 bits, a tag bumped on every
+    // change in the high 32 (so a stale compare-exchange cannot succeed)
+    std::atomic<uint64_t> free_head{NONE};
+    std::atomic<size_t> free_count{0};
+    std::atomic<uint64_t> exhausted{0};
+
+    friend class AudioBlockRef;
+
+    void recycle(AudioBlock* b) {
+        uint64_t head = free_head.load(std::memory_order_relaxed);
+        uint64_t next;
+        do {
+            b->next_free.store((uint32_t)head, std::memory_order_relaxed);
+            next = (((head >> 32) + 1) << 32) | b->index;
+        } while (!free_head.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+        free_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+public:
+    BlockPool(size_t count, size_t frames)
+        : blocks(new AudioBlock[count]), storage(count * frames), block_count(count), max_frames(frames) {
+        for (size_t i = count; i-- > 0;) {
+            blocks[i].index = (uint32_t)i;
+            blocks[i].pool = this;
+            blocks[i].samples = &storage[i * frames];
+            recycle(&blocks[i]);
+        }
+    }
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    // A free block with one reference and cleared metadata, or an empty
+    // ref if every block is in use (counted)
+    AudioBlockRef allocate() {
+        uint64_t head = free_head.load(std::memory_order_acquire);
+        while (true) {
+            uint32_t index = (uint32_t)head;
+            if (index == NONE) {
+                exhausted.fetch_add(1, std::memory_order_relaxed);
+                return AudioBlockRef();
+            }
+            uint64_t next = (((head >> 32) + 1) << 32) | blocks[index].next_free.load(std::memory_order_relaxed);
+            if (free_head.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+                free_count.fetch_sub(1, std::memory_order_relaxed);
+                AudioBlock* b = &blocks[index];
+                b->stream = 0;
+                b->sequence = 0;
+                b->result = BlockResult::SILENCE;
+                b->end_of_stream = false;
+                b->frames = 0;
+                b->refs.store(1, std::memory_order_relaxed);
+                return AudioBlockRef(b);
+            }
+        }
+    }
+
+    size_t capacity() const { return block_count; }
+    size_t maxFrames() const { return max_frames; }
+    size_t available() const { return free_count.load(std::memory_order_relaxed); }
+    uint64_t exhaustedCount() const { return exhausted.load(std::memory_order_relaxed); }
+};
+
+inline void AudioBlockRef::drop() {
+    if (block && block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        block->pool->recycle(block);
+    }
+    block = nullptr;
+}
+
+// The most recent `capacity` blocks of a stream, kept by reference (e.g.
+// as pre-roll to replay). Pushing past capacity releases the oldest.
+class BlockHistory {
+private:
+    std::vector<AudioBlockRef> ring;
+    size_t head = 0;
+    size_t count = 0;
+
+public:
+    explicit BlockHistory(size_t capacity) : ring(capacity) {}
+
+    void push(const AudioBlockRef& block) {
+        if (ring.empty()) return;
+        ring[head] = block;
+        head = (head + 1) % ring.size();
+        if (count < ring.size()) count++;
+    }
+
+    size_t size() const { return count; }
+
+    // Oldest first
+    const AudioBlockRef& at(size_t i) const { return ring[(head + ring.size() - count + i) % ring.size()]; }
+
+    unsigned long frames() const {
+        unsigned long total = 0;
+        for (size_t i = 0; i < count; ++i) total += at(i)->frames;
+        return total;
+    }
+
+    void clear() {
+        for (AudioBlockRef& block : ring) block.reset();
+        head = count = 0;
+    }
+};
+
+#endif // AUDIO_BLOCK_H
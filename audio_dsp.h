@@ -0,0 +1,67 @@
+// Audio preprocessing stages shared by the live programs and the replay
+// benchmarks: noise gate, DC-blocking high-pass filter and automatic gain
+// control. All state is passed in by the caller.
+
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+// Noise gate: true if the block's RMS level is above `threshold`
+inline bool isAudioAboveNoiseGate(const short* audio_data, unsigned long frame_count, double threshold) {
+    // Integer sum: exact, like the double sum it replaces, but vectorizes
+    int64_t sum = 0;
+    for (unsigned long i = 0; i < frame_count; ++i) {
+        sum += audio_data[i] * audio_data[i];
+    }
+    double rms = sqrt(static_cast<double>(sum) / frame_count);
+    return rms > threshold;
+}
+
+// Simple high-pass filter to remove DC offset and low-frequency noise
+inline void applyHighPassFilter(short* audio_data, unsigned long frame_count, float& prev_input, float& prev_output) {
+    const float alpha = 0.95f; // High-pass filter coefficient
+
+    for (unsigned long i = 0; i < frame_count; ++i) {
+        float input = static_cast<float>(audio_data[i]);
+        float output = alpha * (prev_output + input - prev_input);
+        prev_input = input;
+        prev_output = output;
+
+        // Clamp to 16-bit range
+        audio_data[i] = static_cast<short>(std::max(-32768.0f, std::min(32767.0f, output)));
+    }
+}
+
+// Automatic Gain Control: moves `gain` towards target_level / mean level by
+// `adjustment_rate` per block, then applies it
+inline void applyAGC(short* audio_data, unsigned long frame_count, float& gain,
+                     float target_level, float adjustment_rate) {
+    // Calculate current audio level
+    double current_level = 0.0;
+    for (unsigned long i = 0; i < frame_count; ++i) {
+        current_level += abs(audio_data[i]);
+    }
+    current_level /= frame_count;
+
+    // Adjust gain gradually
+    if (current_level > 0) {
+        float desired_gain = target_level / current_level;
+        float new_gain = gain + (desired_gain - gain) * adjustment_rate;
+
+        // Limit gain range
+        new_gain = std::max(0.1f, std::min(10.0f, new_gain));
+        gain = new_gain;
+
+        // Apply gain
+        for (unsigned long i = 0; i < frame_count; ++i) {
+            float sample = audio_data[i] * new_gain;
+            audio_data[i] = static_cast<short>(std::max(-32768.0f, std::min(32767.0f, sample)));
+        }
+    }
+}
+
+#endif // AUDIO_DSP_H
@@ -0,0 +1,136 @@
+// Cross-stream batched preprocessing.
+//
+// The high-pass filter is a recurrence (each output depends on the previous
+// one), so a single stream cannot be vectorized along time. Many streams
+// can: BatchDsp<LANES> takes one block from each of LANES streams, lays the
+// samples out time-major with one SIMD lane per stream, and steps the HPF
+// of all streams together, one time step per vector operation. AGC gets the
+// same treatment. Per-stream state is loaded from and written back to each
+// stream's StreamDspState once per block, so streams can move between
+// batches freely.
+//
+// Results match processBlock() sample for sample. The gate, endpointer and
+// smoothing ring stay per-stream; they are cheap and not recurrent.
+
+#ifndef BATCH_DSP_H
+#define BATCH_DSP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "stream_dsp.h"
+
+// Four lanes per vector: one SSE or NEON register. LANES / 4 vectors give
+// that many independent filter chains per time step, which hides the
+// latency of the recurrence.
+typedef float BatchFloat4 __attribute__((vector_size(16)));
+typedef int32_t BatchInt4 __attribute__((vector_size(16)));
+
+template <int LANES>
+class BatchDsp {
+    static_assert(LANES > 0 && LANES % 4 == 0, "LANES must be a multiple of 4");
+    static const int VECS = LANES / 4;
+
+private:
+    std::vector<BatchFloat4> samples;   // frames x VECS, time-major
+    std::vector<short> silence;         // input of lanes that are not processed
+    std::vector<short> discard;         // output of lanes that are not processed
+
+public:
+    // Processes one block per lane in place. states[l] == nullptr marks an
+    // unused lane. results[l] gets what processBlock() would have returned.
+    void process(StreamDspState* const* states, short* const* blocks,
+                 unsigned long frames, BlockResult* results) {
+        const BatchFloat4 alpha = BatchFloat4{} + 0.95f; // As in applyHighPassFilter()
+        const BatchFloat4 lo = BatchFloat4{} - 32768.0f;
+        const BatchFloat4 hi = BatchFloat4{} + 32767.0f;
+        BatchFloat4 prev_input[VECS], prev_output[VECS], gain[VECS];
+        BatchInt4 level[VECS];
+        const short* in[LANES];
+        bool any = false;
+
+        // 1. Gate each stream and load filter state of the ones that pass
+        if (silence.size() < frames) silence.assign(frames, 0);
+        for (int k = 0; k < VECS; ++k) {
+            prev_input[k] = prev_output[k] = gain[k] = BatchFloat4{};
+            level[k] = BatchInt4{};
+        }
+        for (int l = 0; l < LANES; ++l) {
+            in[l] = silence.data();
+            if (!states[l]) {
+                results[l] = BlockResult::SILENCE;
+                continue;
+            }
+            results[l] = gateBlock(*states[l], blocks[l], frames);
+            if (results[l] != BlockResult::SPEECH) continue;
+            any = true;
+            in[l] = blocks[l];
+            prev_input[l / 4][l % 4] = states[l]->hpf_prev_input;
+            prev_output[l / 4][l % 4] = states[l]->hpf_prev_output;
+        }
+        if (!any) return;
+
+        // 2. Transpose to time-major and run the HPF of all lanes per time
+        // step. The clamped output is truncated to an integer as the 16-bit
+        // store in applyHighPassFilter() does, and its magnitude feeds the
+        // AGC level.
+        if (samples.size() < frames * VECS) samples.resize(frames * VECS);
+        BatchFloat4* x = samples.data();
+        for (unsigned long i = 0; i < frames; ++i) {
+            for (int k = 0; k < VECS; ++k) {
+                BatchFloat4 input = {(float)in[k * 4][i], (float)in[k * 4 + 1][i],
+                                     (float)in[k * 4 + 2][i], (float)in[k * 4 + 3][i]};
+                BatchFloat4 output = alpha * (prev_output[k] + input - prev_input[k]);
+                prev_input[k] = input;
+                prev_output[k] = output;
+                BatchFloat4 clamped = output < lo ? lo : (output > hi ? hi : output);
+                BatchInt4 truncated = __builtin_convertvector(clamped, BatchInt4);
+                x[i * VECS + k] = __builtin_convertvector(truncated, BatchFloat4);
+                level[k] += truncated < 0 ? -truncated : truncated;
+            }
+        }
+
+        // 3. Gain update, as in applyAGC(); a lane whose level is zero keeps
+        // its gain and passes through with a factor of 1
+        for (int l = 0; l < LANES; ++l) {
+            gain[l / 4][l % 4] = 1.0f;
+            if (in[l] == silence.data()) continue;
+            StreamDspState& s = *states[l];
+            s.hpf_prev_input = prev_input[l / 4][l % 4];
+            s.hpf_prev_output = prev_output[l / 4][l % 4];
+            double current_level = static_cast<double>(level[l / 4][l % 4]) / frames;
+            if (current_level > 0) {
+                float desired_gain = s.config.agc_target_level / current_level;
+                float new_gain = s.gain + (desired_gain - s.gain) * s.config.agc_adjustment_rate;
+                s.gain = std::max(0.1f, std::min(10.0f, new_gain));
+                gain[l / 4][l % 4] = s.gain;
+            }
+            s.published_gain.store(s.gain, std::memory_order_relaxed);
+        }
+
+        // 4. Apply gain to all lanes per time step and transpose back; lanes
+        // that were not processed write to scratch
+        if (discard.size() < frames) discard.resize(frames);
+        short* out[LANES];
+        for (int l = 0; l < LANES; ++l) out[l] = (in[l] == silence.data()) ? discard.data() : blocks[l];
+        for (unsigned long i = 0; i < frames; ++i) {
+            for (int k = 0; k < VECS; ++k) {
+                BatchFloat4 v = x[i * VECS + k] * gain[k];
+                v = v < lo ? lo : (v > hi ? hi : v);
+                BatchInt4 q = __builtin_convertvector(v, BatchInt4);
+                out[k * 4][i] = static_cast<short>(q[0]);
+                out[k * 4 + 1][i] = static_cast<short>(q[1]);
+                out[k * 4 + 2][i] = static_cast<short>(q[2]);
+                out[k * 4 + 3][i] = static_cast<short>(q[3]);
+            }
+        }
+
+        // 5. Smoothing ring, per stream
+        for (int l = 0; l < LANES; ++l) {
+            if (in[l] != silence.data()) smoothBlock(*states[l], blocks[l], frames);
+        }
+    }
+};
+
+#endif // BATCH_DSP_H
@@ -0,0 +1,170 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "stream_dsp.h"
+#include "batch_dsp.h"
+#include "wav_reader.h"
+
+// Compares per-stream preprocessing (processBlock on each stream in turn)
+// with BatchDsp at 8 and 16 lanes, for many concurrent streams. Every stream
+// replays the same source from a different offset, so some streams are in
+// speech while others are gated, as on a real server. The batched output
+// is checked against the per-stream output sample for sample.
+//
+// Usage: bench_batch_dsp [streams] [seconds] [file.wav]
+//        Without a file a synthetic speech-like signal is used.
+
+#define SAMPLE_RATE         (16000)
+#define FRAMES_PER_BUFFER   (512)
+
+// Bursts of harmonics with pauses, plus a little DC and hum for the HPF
+static std::vector<short> syntheticSource(double seconds) {
+    std::vector<short> audio(static_cast<size_t>(seconds * SAMPLE_RATE));
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < audio.size(); ++i) {
+        double t = i / (double)SAMPLE_RATE;
+        bool voiced = std::fmod(t, 2.3) < 1.4;
+        double v = 300.0 + 60.0 * std::sin(2 * M_PI * 50.0 * t);
+        seed = seed * 1103515245u + 12345u;
+        v += ((seed >> 16) % 200) - 100.0;
+        if (voiced) {
+            double f0 = 120.0 + 30.0 * std::sin(2 * M_PI * 0.7 * t);
+            for (int h = 1; h <= 6; ++h) v += 2500.0 / h * std::sin(2 * M_PI * f0 * h * t);
+        }
+        audio[i] = static_cast<short>(std::max(-32768.0, std::min(32767.0, v)));
+    }
+    return audio;
+}
+
+struct Streams {
+    std::vector<std::unique_ptr<StreamDspState>> states;
+    std::vector<std::vector<short>> blocks;
+    std::vector<BlockResult> results;
+
+    explicit Streams(size_t n) : blocks(n, std::vector<short>(FRAMES_PER_BUFFER)), results(n) {
+        for (size_t i = 0; i < n; ++i) states.emplace_back(new StreamDspState());
+    }
+
+    // Copies block `b` of every stream's share of the source into place
+    void load(const std::vector<short>& source, size_t b) {
+        size_t blocks_in_source = source.size() / FRAMES_PER_BUFFER;
+        for (size_t s = 0; s < blocks.size(); ++s) {
+            size_t pos = ((b + s * 37) % blocks_in_source) * FRAMES_PER_BUFFER;
+            std::copy(source.begin() + pos, source.begin() + pos + FRAMES_PER_BUFFER, blocks[s].begin());
+        }
+    }
+};
+
+struct RunResult {
+    double seconds = 0.0;
+    uint64_t checksum = 0;
+    uint64_t speech_blocks = 0;
+};
+
+static void accumulate(const Streams& st, RunResult& r) {
+    for (size_t s = 0; s < st.blocks.size(); ++s) {
+        if (st.results[s] != BlockResult::SPEECH) continue;
+        r.speech_blocks++;
+        for (short v : st.blocks[s]) r.checksum = r.checksum * 31 + static_cast<uint16_t>(v);
+    }
+}
+
+static RunResult runPerStream(const std::vector<short>& source, size_t n, size_t total_blocks) {
+    Streams st(n);
+    RunResult r;
+    for (size_t b = 0; b < total_blocks; ++b) {
+        st.load(source, b);
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t s = 0; s < n; ++s) {
+            st.results[s] = processBlock(*st.states[s], st.blocks[s].data(), FRAMES_PER_BUFFER);
+        }
+        r.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        accumulate(st, r);
+    }
+    return r;
+}
+
+template <int LANES>
+static RunResult runBatched(const std::vector<short>& source, size_t n, size_t total_blocks) {
+    Streams st(n);
+    RunResult r;
+    BatchDsp<LANES> engine;
+    StreamDspState* states[LANES];
+    short* blocks[LANES];
+    for (size_t b = 0; b < total_blocks; ++b) {
+        st.load(source, b);
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t base = 0; base < n; base += LANES) {
+            for (int l = 0; l < LANES; ++l) {
+                size_t s = base + l;
+                states[l] = s < n ? st.states[s].get() : nullptr;
+                blocks[l] = s < n ? st.blocks[s].data() : nullptr;
+            }
+            BlockResult results[LANES];
+            engine.process(states, blocks, FRAMES_PER_BUFFER, results);
+            for (int l = 0; l < LANES && base + l < n; ++l) st.results[base + l] = results[l];
+        }
+        r.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        accumulate(st, r);
+    }
+    return r;
+}
+
+static void report(const char* name, const RunResult& r, const RunResult& baseline,
+                   size_t n, size_t total_blocks) {
+    double stream_blocks = static_cast<double>(n) * total_blocks;
+    std::cout << std::left << std::setw(16) << name << std::right << std::fixed
+              << std::setprecision(3) << std::setw(10) << r.seconds
+              << std::setprecision(1) << std::setw(12) << r.seconds * 1e9 / stream_blocks
+              << std::setw(12) << stream_blocks * FRAMES_PER_BUFFER / r.seconds / 1e6
+              << std::setprecision(2) << std::setw(10) << baseline.seconds / r.seconds << "x"
+              << std::setw(10) << (r.checksum == baseline.checksum ? "yes" : "NO") << std::endl;
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 256;
+    double seconds = argc > 2 ? strtod(argv[2], nullptr) : 60.0;
+    if (n == 0 || seconds <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [streams] [seconds] [file.wav]" << std::endl;
+        return 1;
+    }
+
+    std::vector<short> source;
+    if (argc > 3) {
+        int rate = 0;
+        if (!readWavFile(argv[3], source, rate)) return 1;
+        if (rate != SAMPLE_RATE) {
+            std::cerr << "ERROR: \"" << argv[3] << "\" is " << rate << " Hz, need " << SAMPLE_RATE << std::endl;
+            return 1;
+        }
+    } else {
+        source = syntheticSource(30.0);
+    }
+    if (source.size() < FRAMES_PER_BUFFER) {
+        std::cerr << "ERROR: Source shorter than one block." << std::endl;
+        return 1;
+    }
+
+    size_t total_blocks = static_cast<size_t>(seconds * SAMPLE_RATE / FRAMES_PER_BUFFER);
+    std::cout << n << " streams x " << std::fixed << std::setprecision(1) << seconds
+              << " s of audio, " << FRAMES_PER_BUFFER << "-frame blocks" << std::endl;
+
+    RunResult base = runPerStream(source, n, total_blocks);
+    RunResult b8 = runBatched<8>(source, n, total_blocks);
+    RunResult b16 = runBatched<16>(source, n, total_blocks);
+
+    std::cout << "Speech blocks: " << base.speech_blocks << " of " << n * total_blocks << std::endl;
+    std::cout << std::left << std::setw(16) << "path" << std::right << std::setw(10) << "dsp s"
+              << std::setw(12) << "ns/block" << std::setw(12) << "Msamp/s"
+              << std::setw(11) << "speedup" << std::setw(10) << "match" << std::endl;
+    report("per-stream", base, base, n, total_blocks);
+    report("batch x8", b8, base, n, total_blocks);
+    report("batch x16", b16, base, n, total_blocks);
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <time.h>
+
+#include "vosk_api.h"
+#include "vosk_result.h"
+#include "chunk_coalescer.h"
+#include "wav_reader.h"
+
+// Sweeps the decoder chunk size and reports, for each size, the real-time
+// factor and how long after a word was spoken it first shows up in a
+// partial (or final) result. Audio arrives in 512-frame capture blocks and
+// goes through ChunkCoalescer exactly as in voice_w_cbuff.cpp; a word's
+// latency is the capture time at which its chunk was complete, plus the
+// time spent decoding that chunk, minus the word's end time.
+//
+// Usage: bench_chunk_sweep <model_dir> <max_delay_ms|0> <file.wav>...
+
+#define SAMPLE_RATE         (16000)
+#define FRAMES_PER_BUFFER   (512)
+
+struct SweepResult {
+    double cpu_seconds = 0.0;
+    unsigned long calls = 0;
+    std::vector<double> word_latency_ms;
+};
+
+static double threadCpuSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run(VoskModel *model, const std::vector<short>& audio, size_t chunk_frames,
+                uint64_t max_delay_frames, SweepResult& result) {
+    VoskRecognizer *recognizer = vosk_recognizer_new(model, (float)SAMPLE_RATE);
+    if (!recognizer) return;
+    vosk_recognizer_set_words(recognizer, 1);
+    vosk_recognizer_set_partial_words(recognizer, 1);
+
+    ChunkCoalescer coalescer(chunk_frames, max_delay_frames);
+    std::vector<VoskWord> words;
+    size_t seen = 0;   // words of the current utterance already reported
+
+    auto collect = [&](const char *json, const char *key, double emitted_ms) {
+        if (!parseVoskWords(json, key, words)) words.clear();
+        for (size_t i = seen; i < words.size(); ++i) {
+            result.word_latency_ms.push_back(emitted_ms - words[i].end * 1000.0);
+        }
+        seen = words.size();
+    };
+
+    double cpu_start = threadCpuSeconds();
+    for (size_t pos = 0; pos + FRAMES_PER_BUFFER <= audio.size(); pos += FRAMES_PER_BUFFER) {
+        uint64_t now = pos + FRAMES_PER_BUFFER;
+        if (!coalescer.push(audio.data() + pos, FRAMES_PER_BUFFER, now)) continue;
+
+        auto t0 = std::chrono::steady_clock::now();
+        int status = vosk_recognizer_accept_waveform_s(recognizer, coalescer.data(), coalescer.size());
+        coalescer.consume();
+        const char *json = (status > 0) ? vosk_recognizer_result(recognizer)
+                                        : vosk_recognizer_partial_result(recognizer);
+        double decode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        result.calls++;
+
+        double emitted_ms = now * 1000.0 / SAMPLE_RATE + decode_ms;
+        collect(json, (status > 0) ? "result" : "partial_result", emitted_ms);
+        if (status > 0) seen = 0;
+    }
+    if (!coalescer.empty()) {
+        vosk_recognizer_accept_waveform_s(recognizer, coalescer.data(), coalescer.size());
+    }
+    vosk_recognizer_final_result(recognizer);
+    result.cpu_seconds += threadCpuSeconds() - cpu_start;
+    vosk_recognizer_free(recognizer);
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t idx = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+    return values[std::min(values.size() - 1, idx > 0 ? idx - 1 : 0)];
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <model_dir> <max_delay_ms|0> <file.wav>..." << std::endl;
+        return 1;
+    }
+    uint64_t max_delay_frames = strtoull(argv[2], nullptr, 10) * SAMPLE_RATE / 1000;
+
+    vosk_set_log_level(-1);
+    VoskModel *model = vosk_model_new(argv[1]);
+    if (!model) {
+        std::cerr << "ERROR: Failed to load Vosk model from \"" << argv[1] << "\"" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::vector<short>> corpus;
+    double audio_seconds = 0.0;
+    for (int i = 3; i < argc; ++i) {
+        std::vector<short> audio;
+        int rate = 0;
+        if (!readWavFile(argv[i], audio, rate)) continue;
+        if (rate != SAMPLE_RATE) {
+            std::cerr << "WARNING: Skipping \"" << argv[i] << "\" (" << rate << " Hz, need " << SAMPLE_RATE << ")" << std::endl;
+            continue;
+        }
+        audio_seconds += audio.size() / (double)SAMPLE_RATE;
+        corpus.push_back(std::move(audio));
+    }
+    if (corpus.empty()) {
+        std::cerr << "ERROR: No usable audio." << std::endl;
+        vosk_model_free(model);
+        return 1;
+    }
+
+    const unsigned chunk_ms[] = {32, 64, 96, 128, 160, 200, 256, 320, 400, 512};
+    std::cout << "Corpus: " << corpus.size() << " file(s), " << std::fixed << std::setprecision(1)
+              << audio_seconds << " s; latency cap " << argv[2] << " ms" << std::endl;
+    std::cout << std::setw(8) << "chunk" << std::setw(10) << "RTF" << std::setw(10) << "calls/s"
+              << std::setw(12) << "us/call" << std::setw(12) << "p50 ms" << std::setw(12) << "p90 ms"
+              << std::setw(12) << "p99 ms" << std::endl;
+    for (unsigned ms : chunk_ms) {
+        SweepResult r;
+        // Chunks are whole capture blocks, as in the live program
+        size_t frames = std::max<size_t>(1, ms * SAMPLE_RATE / 1000 / FRAMES_PER_BUFFER) * FRAMES_PER_BUFFER;
+        for (const std::vector<short>& audio : corpus) run(model, audio, frames, max_delay_frames, r);
+        std::cout << std::setw(6) << frames * 1000 / SAMPLE_RATE << "ms"
+                  << std::setprecision(3) << std::setw(10) << r.cpu_seconds / audio_seconds
+                  << std::setprecision(1) << std::setw(10) << r.calls / audio_seconds
+                  << std::setw(12) << (r.calls ? r.cpu_seconds * 1e6 / r.calls : 0.0)
+                  << std::setw(12) << percentile(r.word_latency_ms, 50)
+                  << std::setw(12) << percentile(r.word_latency_ms, 90)
+                  << std::setw(12) << percentile(r.word_latency_ms, 99) << std::endl;
+    }
+
+    vosk_model_free(model);
+    return 0;
+}
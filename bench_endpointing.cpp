@@ -0,0 +1,150 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "vosk_api.h"
+#include "vosk_result.h"
+#include "stream_dsp.h"
+#include "wav_reader.h"
+
+// Replays WAV files through the voice_w_cbuff.cpp preprocessing chain
+// twice - once relying on Vosk's endpointer only, once with the gate-driven
+// client endpointer - and reports how long after the last word of each
+// utterance its final result arrived. Latency is measured in audio time, so
+// the numbers equal what a live stream would see.
+//
+// Usage: bench_endpointing <model_dir> <silence_ms> <file.wav>...
+
+#define SAMPLE_RATE             (16000)
+#define FRAMES_PER_BUFFER       (512)
+#define NOISE_GATE_THRESHOLD    (500)
+#define AGC_TARGET_LEVEL        (8000)
+#define AGC_ADJUSTMENT_RATE     (0.1f)
+#define PAIR_TOLERANCE_MS       (250)   // Same utterance if last words end this close
+
+struct FinalEvent {
+    int64_t last_word_end_ms;   // capture time of the end of the last word
+    int64_t latency_ms;         // emission time minus last_word_end_ms
+};
+
+// Runs one file through gate -> HPF -> AGC -> Vosk and records every final
+static std::vector<FinalEvent> replay(VoskModel *model, const std::vector<short>& audio, unsigned long silence_ms) {
+    std::vector<FinalEvent> events;
+    VoskRecognizer *recognizer = vosk_recognizer_new(model, (float)SAMPLE_RATE);
+    if (!recognizer) {
+        std::cerr << "ERROR: Failed to create Vosk recognizer." << std::endl;
+        return events;
+    }
+    vosk_recognizer_set_words(recognizer, 1);
+
+    StreamTimeline timeline;
+    timeline.start(0, SAMPLE_RATE);
+    StreamDspConfig dsp_config;
+    dsp_config.gate_threshold = NOISE_GATE_THRESHOLD;
+    dsp_config.agc_target_level = AGC_TARGET_LEVEL;
+    dsp_config.agc_adjustment_rate = AGC_ADJUSTMENT_RATE;
+    dsp_config.silence_ms = silence_ms;
+    dsp_config.sample_rate = SAMPLE_RATE;
+    StreamDspState dsp(dsp_config);
+    std::vector<short> block(FRAMES_PER_BUFFER);
+    std::vector<VoskWord> words;
+
+    auto record = [&](const char *json, size_t position) {
+        if (!parseVoskWords(json, "result", words) || words.empty()) return;
+        int64_t end_ms = timeline.toEpochMs(words.back().end);
+        int64_t now_ms = static_cast<int64_t>(position) * 1000 / SAMPLE_RATE;
+        events.push_back({end_ms, now_ms - end_ms});
+    };
+
+    for (size_t pos = 0; pos + FRAMES_PER_BUFFER <= audio.size(); pos += FRAMES_PER_BUFFER) {
+        std::copy(audio.begin() + pos, audio.begin() + pos + FRAMES_PER_BUFFER, block.begin());
+        size_t block_end = pos + FRAMES_PER_BUFFER;
+
+        BlockResult block_result = processBlock(dsp, block.data(), FRAMES_PER_BUFFER);
+        timeline.onBlock(FRAMES_PER_BUFFER, block_result == BlockResult::SPEECH);
+        if (block_result != BlockResult::SPEECH) {
+            if (block_result == BlockResult::END_OF_SPEECH) {
+                record(vosk_recognizer_final_result(recognizer), block_end);
+            }
+            continue;
+        }
+
+        if (vosk_recognizer_accept_waveform_s(recognizer, block.data(), FRAMES_PER_BUFFER) > 0) {
+            dsp.endpointer.onFinal();
+            record(vosk_recognizer_result(recognizer), block_end);
+        }
+    }
+    record(vosk_recognizer_final_result(recognizer), audio.size());
+    vosk_recognizer_free(recognizer);
+    return events;
+}
+
+static int64_t percentile(std::vector<int64_t> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t idx = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+    return values[std::min(values.size() - 1, idx > 0 ? idx - 1 : 0)];
+}
+
+static void printDistribution(const char *label, const std::vector<int64_t>& values) {
+    std::cout << std::left << std::setw(22) << label << std::right
+              << " n=" << std::setw(5) << values.size()
+              << "  p10=" << std::setw(6) << percentile(values, 10)
+              << "  p50=" << std::setw(6) << percentile(values, 50)
+              << "  p90=" << std::setw(6) << percentile(values, 90)
+              << "  p99=" << std::setw(6) << percentile(values, 99) << "  (ms)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <model_dir> <silence_ms> <file.wav>..." << std::endl;
+        return 1;
+    }
+    unsigned long silence_ms = strtoul(argv[2], nullptr, 10);
+
+    vosk_set_log_level(-1);
+    VoskModel *model = vosk_model_new(argv[1]);
+    if (!model) {
+        std::cerr << "ERROR: Failed to load Vosk model from \"" << argv[1] << "\"" << std::endl;
+        return 1;
+    }
+
+    std::vector<int64_t> baseline_latency, endpointer_latency, improvement;
+    for (int i = 3; i < argc; ++i) {
+        std::vector<short> audio;
+        int rate = 0;
+        if (!readWavFile(argv[i], audio, rate)) continue;
+        if (rate != SAMPLE_RATE) {
+            std::cerr << "WARNING: Skipping \"" << argv[i] << "\" (" << rate << " Hz, need " << SAMPLE_RATE << ")" << std::endl;
+            continue;
+        }
+
+        std::vector<FinalEvent> base = replay(model, audio, 0);
+        std::vector<FinalEvent> forced = replay(model, audio, silence_ms);
+        for (const FinalEvent& e : base) baseline_latency.push_back(e.latency_ms);
+        for (const FinalEvent& e : forced) {
+            endpointer_latency.push_back(e.latency_ms);
+            // Pair with the baseline final that ended on the same word
+            for (const FinalEvent& b : base) {
+                if (std::llabs(b.last_word_end_ms - e.last_word_end_ms) <= PAIR_TOLERANCE_MS) {
+                    improvement.push_back(b.latency_ms - e.latency_ms);
+                    break;
+                }
+            }
+        }
+        std::cout << argv[i] << ": " << base.size() << " finals (Vosk), " << forced.size()
+                  << " finals (endpointer)" << std::endl;
+    }
+
+    std::cout << "\n=== Final-result latency after last word, silence " << silence_ms << " ms ===" << std::endl;
+    printDistribution("Vosk endpointer only", baseline_latency);
+    printDistribution("Client endpointer", endpointer_latency);
+    printDistribution("Improvement (paired)", improvement);
+
+    vosk_model_free(model);
+    return 0;
+}
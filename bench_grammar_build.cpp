@@ -0,0 +1,148 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+
+#include "vosk_api.h"
+#include "grammar_builder.h"
+
+// Grammar build time for a large phrase list.
+//
+// Generates `phrases` phrases of 1-4 words drawn from a vocabulary of
+// `vocabulary` words (taken from the model's graph/words.txt when present,
+// so the words are known to the model) and builds the grammar JSON three
+// ways:
+//
+//   naive    one vosk_model_find_word() per word occurrence, no dedup
+//   builder  GrammarBuilder: normalize, dedup, one lookup per distinct word
+//   rebuild  GrammarBuilder after clear(), with the lookup cache warm
+//
+// and finally compiles the builder's grammar with vosk_recognizer_new_grm().
+//
+// Usage: bench_grammar_build <model_dir> [phrases] [vocabulary]
+
+#define SAMPLE_RATE         (16000)
+#define BENCH_SEED          (42)
+
+static double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Model words, skipping Kaldi's special symbols; synthetic words if the
+// model has no word list (those are mostly unknown and get dropped)
+static std::vector<std::string> loadVocabulary(const std::string& model_dir, size_t wanted) {
+    std::vector<std::string> words;
+    std::ifstream in(model_dir + "/graph/words.txt");
+    std::string word, id;
+    while (words.size() < wanted && in >> word >> id) {
+        if (word.empty() || word[0] == '<' || word[0] == '#' || word[0] == '!' || word[0] == '[') continue;
+        words.push_back(word);
+    }
+    for (size_t i = 0; words.size() < wanted; ++i) words.push_back("word" + std::to_string(i));
+    return words;
+}
+
+static std::vector<std::string> generatePhrases(const std::vector<std::string>& vocabulary, size_t count) {
+    std::mt19937 rng(BENCH_SEED);
+    std::uniform_int_distribution<size_t> pick(0, vocabulary.size() - 1);
+    std::uniform_int_distribution<int> length(1, 4);
+    std::vector<std::string> phrases;
+    phrases.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string phrase;
+        for (int n = length(rng); n > 0; --n) {
+            if (!phrase.empty()) phrase += ' ';
+            phrase += vocabulary[pick(rng)];
+        }
+        phrases.push_back(phrase);
+    }
+    return phrases;
+}
+
+// What a hand-rolled loop does: look up every word, concatenate the rest
+static std::string naiveGrammar(VoskModel* model, const std::vector<std::string>& phrases, size_t& lookups,
+                                size_t& kept) {
+    std::string out = "[";
+    for (const std::string& phrase : phrases) {
+        bool known = true;
+        size_t begin = 0;
+        while (begin < phrase.size()) {
+            size_t end = phrase.find(' ', begin);
+            if (end == std::string::npos) end = phrase.size();
+            lookups++;
+            if (vosk_model_find_word(model, phrase.substr(begin, end - begin).c_str()) < 0) known = false;
+            begin = end + 1;
+        }
+        if (!known) continue;
+        kept++;
+        if (out.size() > 1) out += ", ";
+        out += "\"" + phrase + "\"";
+    }
+    return out + ", \"[unk]\"]";
+}
+
+static void printRow(const char* mode, double ms, size_t lookups, size_t kept, size_t bytes) {
+    std::cout << std::left << std::setw(10) << mode << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << ms << std::setw(12) << lookups << std::setw(12) << kept
+              << std::setw(12) << bytes / 1024 << std::endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <model_dir> [phrases] [vocabulary]" << std::endl;
+        return 1;
+    }
+    size_t phrase_count = argc > 2 ? strtoul(argv[2], nullptr, 10) : 50000;
+    size_t vocabulary_size = argc > 3 ? strtoul(argv[3], nullptr, 10) : 3000;
+    if (phrase_count == 0 || vocabulary_size == 0) {
+        std::cerr << "ERROR: phrases and vocabulary must be positive." << std::endl;
+        return 1;
+    }
+
+    vosk_set_log_level(-1);
+    VoskModel* model = vosk_model_new(argv[1]);
+    if (!model) {
+        std::cerr << "ERROR: Failed to load Vosk model from \"" << argv[1] << "\"" << std::endl;
+        return 1;
+    }
+    std::vector<std::string> vocabulary = loadVocabulary(argv[1], vocabulary_size);
+    std::vector<std::string> phrases = generatePhrases(vocabulary, phrase_count);
+
+    std::cout << phrase_count << " phrases over " << vocabulary.size() << " words" << std::endl;
+    std::cout << std::left << std::setw(10) << "mode" << std::right << std::setw(12) << "build ms"
+              << std::setw(12) << "lookups" << std::setw(12) << "phrases" << std::setw(12) << "JSON KB" << std::endl;
+
+    size_t naive_lookups = 0, naive_kept = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::string naive = naiveGrammar(model, phrases, naive_lookups, naive_kept);
+    printRow("naive", msSince(start), naive_lookups, naive_kept, naive.size());
+
+    GrammarBuilder builder(model);
+    builder.addPhrases(phrases);
+    std::string json = builder.json();
+    const GrammarReport& report = builder.getReport();
+    printRow("builder", report.build_ms, report.model_lookups, builder.phraseCount(), json.size());
+
+    builder.clear();
+    builder.addPhrases(phrases);
+    std::string rebuilt = builder.json();
+    printRow("rebuild", builder.getReport().build_ms, builder.getReport().model_lookups,
+             builder.phraseCount(), rebuilt.size());
+
+    start = std::chrono::steady_clock::now();
+    VoskRecognizer* recognizer = vosk_recognizer_new_grm(model, (float)SAMPLE_RATE, json.c_str());
+    double compile_ms = msSince(start);
+    if (!recognizer) {
+        std::cerr << "ERROR: Failed to compile the grammar." << std::endl;
+    } else {
+        std::cout << "Grammar compile (vosk_recognizer_new_grm): " << std::setprecision(1) << compile_ms
+                  << " ms" << std::endl;
+        vosk_recognizer_free(recognizer);
+    }
+    vosk_model_free(model);
+    return recognizer ? 0 : 1;
+}
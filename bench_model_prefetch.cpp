@@ -0,0 +1,187 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "vosk_api.h"
+#include "model_prefetch.h"
+
+// Cold-start time of vosk_model_new() with and without the prefetcher.
+//
+// Local disk: before every run the model files are dropped from the page
+// cache (POSIX_FADV_DONTNEED; run as root with --drop-caches to drop all
+// caches instead), then the model is loaded with each prefetch mode
+// running alongside.
+//
+// Slow mount: a network filesystem is simulated by charging every 1 MB
+// request a fixed latency plus transfer time at a per-stream bandwidth,
+// with requests from different threads proceeding in parallel, as on NFS.
+// The bench reports how long the model's bytes take to arrive read
+// serially (as the loader reads) and by the prefetch thread pool, and
+// estimates cold start as I/O time plus the warm-cache load time.
+//
+// Usage: bench_model_prefetch [--drop-caches] <model_dir> [threads] [latency_ms] [stream_mb_s]
+//        Defaults: 16 threads, 2 ms, 100 MB/s.
+
+#define SLOW_MOUNT_REQUEST_BYTES    (1024 * 1024)
+
+static double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Fraction of the model's pages currently in the page cache
+static double residentFraction(const std::vector<ModelFile>& files) {
+    uint64_t pages = 0, resident = 0;
+    long page = sysconf(_SC_PAGESIZE);
+    for (const ModelFile& f : files) {
+        if (f.size == 0) continue;
+        int fd = open(f.path.c_str(), O_RDONLY);
+        if (fd < 0) continue;
+        void* map = mmap(nullptr, f.size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) continue;
+        size_t n = (f.size + page - 1) / page;
+        std::vector<unsigned char> vec(n);
+        if (mincore(map, f.size, vec.data()) == 0) {
+            for (unsigned char v : vec) resident += v & 1;
+            pages += n;
+        }
+        munmap(map, f.size);
+    }
+    return pages ? (double)resident / pages : 0.0;
+}
+
+static void evict(const std::vector<ModelFile>& files, bool drop_caches) {
+    sync();
+    if (drop_caches) {
+        int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+        if (fd >= 0) {
+            if (write(fd, "3", 1) != 1) std::cerr << "WARNING: drop_caches failed." << std::endl;
+            close(fd);
+            return;
+        }
+        std::cerr << "WARNING: Cannot open drop_caches; falling back to fadvise." << std::endl;
+    }
+    for (const ModelFile& f : files) {
+        int fd = open(f.path.c_str(), O_RDONLY);
+        if (fd < 0) continue;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+// Simulated network read of the given requests by `threads` streams
+static double slowMountMs(const std::vector<ModelFile>& files, int threads, double latency_ms, double stream_mb_s) {
+    std::vector<uint64_t> requests;
+    for (const ModelFile& f : files) {
+        for (uint64_t off = 0; off < f.size; off += SLOW_MOUNT_REQUEST_BYTES) {
+            requests.push_back(std::min<uint64_t>(SLOW_MOUNT_REQUEST_BYTES, f.size - off));
+        }
+    }
+    std::atomic<size_t> next(0);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&]() {
+            size_t i;
+            while ((i = next.fetch_add(1)) < requests.size()) {
+                double ms = latency_ms + requests[i] / (stream_mb_s * 1024.0 * 1024.0) * 1000.0;
+                std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long>(ms * 1000)));
+            }
+        });
+    }
+    for (std::thread& t : pool) t.join();
+    return msSince(start);
+}
+
+int main(int argc, char **argv) {
+    int arg = 1;
+    bool drop_caches = false;
+    if (arg < argc && std::string(argv[arg]) == "--drop-caches") {
+        drop_caches = true;
+        arg++;
+    }
+    if (arg >= argc) {
+        std::cerr << "Usage: " << argv[0] << " [--drop-caches] <model_dir> [threads] [latency_ms] [stream_mb_s]" << std::endl;
+        return 1;
+    }
+    const char* model_dir = argv[arg];
+    int threads = arg + 1 < argc ? atoi(argv[arg + 1]) : 16;
+    double latency_ms = arg + 2 < argc ? atof(argv[arg + 2]) : 2.0;
+    double stream_mb_s = arg + 3 < argc ? atof(argv[arg + 3]) : 100.0;
+    if (threads <= 0 || stream_mb_s <= 0) {
+        std::cerr << "ERROR: threads and stream_mb_s must be positive." << std::endl;
+        return 1;
+    }
+
+    std::vector<ModelFile> files;
+    if (!listModelFiles(model_dir, files) || files.empty()) {
+        std::cerr << "ERROR: No model files under \"" << model_dir << "\"" << std::endl;
+        return 1;
+    }
+    uint64_t bytes = 0;
+    for (const ModelFile& f : files) bytes += f.size;
+    std::cout << "Model: " << files.size() << " files, " << std::fixed << std::setprecision(1)
+              << bytes / 1048576.0 << " MB; " << threads << " prefetch threads" << std::endl;
+
+    vosk_set_log_level(-1);
+
+    // 1. Local disk, cold cache
+    std::cout << "\n=== Local disk, cold cache ===" << std::endl;
+    std::cout << std::left << std::setw(12) << "prefetch" << std::right << std::setw(10) << "cached"
+              << std::setw(12) << "load ms" << std::setw(14) << "prefetch ms" << std::setw(10) << "speedup" << std::endl;
+    double baseline = 0.0, warm_ms = 0.0;
+    const char* names[] = {"none", "fadvise", "readahead", "threads"};
+    const PrefetchMode modes[] = {PrefetchMode::FADVISE, PrefetchMode::FADVISE, PrefetchMode::READAHEAD, PrefetchMode::THREADS};
+    for (int m = 0; m < 4; ++m) {
+        evict(files, drop_caches);
+        double cached = residentFraction(files);
+        ModelPrefetcher prefetcher;
+        auto start = std::chrono::steady_clock::now();
+        if (m > 0) prefetcher.start(model_dir, modes[m], threads);
+        VoskModel* model = vosk_model_new(model_dir);
+        double load_ms = msSince(start);
+        prefetcher.wait();
+        if (!model) {
+            std::cerr << "ERROR: Failed to load Vosk model from \"" << model_dir << "\"" << std::endl;
+            return 1;
+        }
+        vosk_model_free(model);
+        if (m == 0) baseline = load_ms;
+        std::cout << std::left << std::setw(12) << names[m] << std::right << std::setprecision(0)
+                  << std::setw(9) << cached * 100 << "%" << std::setprecision(1) << std::setw(12) << load_ms
+                  << std::setw(14) << (m > 0 ? prefetcher.getReport().prefetch_ms : 0.0)
+                  << std::setprecision(2) << std::setw(9) << baseline / load_ms << "x" << std::endl;
+    }
+
+    // Warm cache: what is left once I/O is free
+    {
+        auto start = std::chrono::steady_clock::now();
+        VoskModel* model = vosk_model_new(model_dir);
+        warm_ms = msSince(start);
+        if (model) vosk_model_free(model);
+    }
+    std::cout << "Warm cache load: " << std::setprecision(1) << warm_ms << " ms" << std::endl;
+
+    // 2. Simulated slow mount
+    std::cout << "\n=== Simulated slow mount (" << latency_ms << " ms/request, " << stream_mb_s
+              << " MB/s per stream) ===" << std::endl;
+    double serial_ms = slowMountMs(files, 1, latency_ms, stream_mb_s);
+    double parallel_ms = slowMountMs(files, threads, latency_ms, stream_mb_s);
+    double cold_serial = serial_ms + warm_ms;
+    double cold_parallel = std::max(parallel_ms, warm_ms) + std::min(parallel_ms, warm_ms) / threads;
+    std::cout << "I/O, serial reader:      " << std::setw(10) << serial_ms << " ms" << std::endl;
+    std::cout << "I/O, " << std::setw(2) << threads << " prefetch threads: " << std::setw(10) << parallel_ms << " ms" << std::endl;
+    std::cout << "Estimated cold start:    " << std::setw(10) << cold_serial << " ms without, "
+              << cold_parallel << " ms with prefetch (" << std::setprecision(2) << cold_serial / cold_parallel
+              << "x)" << std::endl;
+    return 0;
+}
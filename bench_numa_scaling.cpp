@@ -0,0 +1,133 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+
+#include "vosk_api.h"
+#include "numa_topology.h"
+#include "wav_reader.h"
+
+// Decode throughput as workers are added socket by socket, with one model
+// replica per NUMA node (each worker reads local weights) and with a single
+// model on the first node (workers on other sockets read remote weights).
+// Every worker decodes the whole corpus once; throughput is audio seconds
+// decoded per wall second over all workers.
+//
+// Usage: bench_numa_scaling <model_dir> <workers_per_node> <file.wav>...
+
+#define SAMPLE_RATE         (16000)
+#define FRAMES_PER_BUFFER   (512)
+
+static void decodeCorpus(const NumaNode& node, VoskModel* model, const std::vector<std::vector<short>>* corpus) {
+    pinThreadToNode(node);
+    preferNodeMemory(node);
+    for (const std::vector<short>& audio : *corpus) {
+        VoskRecognizer* recognizer = vosk_recognizer_new(model, (float)SAMPLE_RATE);
+        if (!recognizer) continue;
+        for (size_t pos = 0; pos + FRAMES_PER_BUFFER <= audio.size(); pos += FRAMES_PER_BUFFER) {
+            if (vosk_recognizer_accept_waveform_s(recognizer, audio.data() + pos, FRAMES_PER_BUFFER) > 0) {
+                vosk_recognizer_result(recognizer);
+            }
+        }
+        vosk_recognizer_final_result(recognizer);
+        vosk_recognizer_free(recognizer);
+    }
+}
+
+// Runs workers_per_node workers on each of the first `nodes` nodes; returns
+// audio seconds decoded per wall second
+static double run(const NumaTopology& topology, size_t nodes, int workers_per_node,
+                  const std::vector<VoskModel*>& models, bool replicas,
+                  const std::vector<std::vector<short>>& corpus, double corpus_seconds) {
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < nodes; ++n) {
+        VoskModel* model = models[replicas ? n : 0];
+        for (int w = 0; w < workers_per_node; ++w) {
+            workers.emplace_back(decodeCorpus, std::cref(topology.node(n)), model, &corpus);
+        }
+    }
+    for (std::thread& t : workers) t.join();
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return corpus_seconds * workers.size() / wall;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <model_dir> <workers_per_node> <file.wav>..." << std::endl;
+        return 1;
+    }
+    int workers_per_node = atoi(argv[2]);
+    if (workers_per_node <= 0) {
+        std::cerr << "ERROR: Need at least one worker per node." << std::endl;
+        return 1;
+    }
+
+    NumaTopology topology;
+    topology.detect();
+
+    std::vector<std::vector<short>> corpus;
+    double corpus_seconds = 0.0;
+    for (int i = 3; i < argc; ++i) {
+        std::vector<short> audio;
+        int rate = 0;
+        if (!readWavFile(argv[i], audio, rate)) continue;
+        if (rate != SAMPLE_RATE) {
+            std::cerr << "WARNING: Skipping \"" << argv[i] << "\" (" << rate << " Hz, need " << SAMPLE_RATE << ")" << std::endl;
+            continue;
+        }
+        corpus_seconds += audio.size() / (double)SAMPLE_RATE;
+        corpus.push_back(std::move(audio));
+    }
+    if (corpus.empty()) {
+        std::cerr << "ERROR: No usable audio." << std::endl;
+        return 1;
+    }
+
+    // One replica per node, each loaded by a thread pinned to its node
+    vosk_set_log_level(-1);
+    std::vector<VoskModel*> models(topology.nodeCount(), nullptr);
+    std::vector<std::thread> loaders;
+    for (size_t n = 0; n < topology.nodeCount(); ++n) {
+        loaders.emplace_back([&, n]() {
+            pinThreadToNode(topology.node(n));
+            preferNodeMemory(topology.node(n));
+            models[n] = vosk_model_new(argv[1]);
+        });
+    }
+    for (std::thread& t : loaders) t.join();
+    for (VoskModel* model : models) {
+        if (!model) {
+            std::cerr << "ERROR: Failed to load Vosk model from \"" << argv[1] << "\"" << std::endl;
+            for (VoskModel* m : models) if (m) vosk_model_free(m);
+            return 1;
+        }
+    }
+
+    std::cout << topology.nodeCount() << " NUMA node(s), " << workers_per_node << " worker(s) per node, corpus "
+              << std::fixed << std::setprecision(1) << corpus_seconds << " s" << std::endl;
+    std::cout << std::setw(7) << "nodes" << std::setw(9) << "workers" << std::setw(16) << "replicas x RT"
+              << std::setw(10) << "scaling" << std::setw(16) << "shared x RT" << std::setw(10) << "scaling"
+              << std::setw(10) << "gain" << std::endl;
+    double base_replicas = 0.0, base_shared = 0.0;
+    for (size_t nodes = 1; nodes <= topology.nodeCount(); ++nodes) {
+        double replicas = run(topology, nodes, workers_per_node, models, true, corpus, corpus_seconds);
+        double shared = run(topology, nodes, workers_per_node, models, false, corpus, corpus_seconds);
+        if (nodes == 1) {
+            base_replicas = replicas;
+            base_shared = shared;
+        }
+        std::cout << std::setw(7) << nodes << std::setw(9) << nodes * workers_per_node
+                  << std::setprecision(1) << std::setw(16) << replicas
+                  << std::setprecision(2) << std::setw(9) << replicas / base_replicas << "x"
+                  << std::setprecision(1) << std::setw(16) << shared
+                  << std::setprecision(2) << std::setw(9) << shared / base_shared << "x"
+                  << std::setprecision(1) << std::setw(9) << 100.0 * (replicas / shared - 1.0) << "%" << std::endl;
+    }
+
+    for (VoskModel* m : models) vosk_model_free(m);
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <time.h>
+
+#include "vosk_api.h"
+#include "stream_dsp.h"
+#include "partial_cadence.h"
+#include "chunk_coalescer.h"
+#include "wav_reader.h"
+
+// Measures decode CPU for each partial cadence, with and without chunk
+// coalescing, on two paths:
+//   live  the voice_w_cbuff.cpp chain: 512-frame blocks, noise gate, HPF, AGC
+//   file  raw WAV samples fed in 512-frame blocks without the gate
+// CPU is the decoding thread's CPU time, so replaying faster than real time
+// gives the same figures as a paced live stream.
+//
+// Usage: bench_partial_cadence <model_dir> <file.wav>...
+
+#define SAMPLE_RATE             (16000)
+#define FRAMES_PER_BUFFER       (512)
+#define NOISE_GATE_THRESHOLD    (500)
+#define AGC_TARGET_LEVEL        (8000)
+#define AGC_ADJUSTMENT_RATE     (0.1f)
+#define COALESCE_MS             (160)
+
+struct RunResult {
+    double cpu_seconds = 0.0;
+    unsigned long partials_polled = 0;
+    unsigned long partials_passed = 0;
+};
+
+static double threadCpuSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static RunResult run(VoskModel *model, const std::vector<std::vector<short>>& corpus, bool live,
+                     PartialMode mode, unsigned long interval_ms, size_t chunk_frames) {
+    RunResult result;
+    std::vector<short> block(FRAMES_PER_BUFFER);
+    for (const std::vector<short>& audio : corpus) {
+        VoskRecognizer *recognizer = vosk_recognizer_new(model, (float)SAMPLE_RATE);
+        if (!recognizer) continue;
+        vosk_recognizer_set_words(recognizer, 1);
+        PartialCadence cadence(mode, interval_ms, SAMPLE_RATE);
+        ChunkCoalescer coalescer(chunk_frames);
+        StreamDspConfig dsp_config;
+        dsp_config.gate_threshold = NOISE_GATE_THRESHOLD;
+        dsp_config.agc_target_level = AGC_TARGET_LEVEL;
+        dsp_config.agc_adjustment_rate = AGC_ADJUSTMENT_RATE;
+        dsp_config.silence_ms = 0;
+        dsp_config.sample_rate = SAMPLE_RATE;
+        StreamDspState dsp(dsp_config);
+
+        double start = threadCpuSeconds();
+        for (size_t pos = 0; pos + FRAMES_PER_BUFFER <= audio.size(); pos += FRAMES_PER_BUFFER) {
+            std::copy(audio.begin() + pos, audio.begin() + pos + FRAMES_PER_BUFFER, block.begin());
+            if (live && processBlock(dsp, block.data(), FRAMES_PER_BUFFER) != BlockResult::SPEECH) continue;
+            if (!coalescer.push(block.data(), FRAMES_PER_BUFFER, pos + FRAMES_PER_BUFFER)) continue;
+
+            unsigned long fed = coalescer.size();
+            int status = vosk_recognizer_accept_waveform_s(recognizer, coalescer.data(), fed);
+            coalescer.consume();
+            if (status > 0) {
+                vosk_recognizer_result(recognizer);
+                cadence.onFinal();
+            } else if (status == 0 && cadence.onAudio(fed)) {
+                result.partials_polled++;
+                if (cadence.accept(vosk_recognizer_partial_result(recognizer))) result.partials_passed++;
+            }
+        }
+        if (!coalescer.empty()) {
+            vosk_recognizer_accept_waveform_s(recognizer, coalescer.data(), coalescer.size());
+        }
+        vosk_recognizer_final_result(recognizer);
+        result.cpu_seconds += threadCpuSeconds() - start;
+        vosk_recognizer_free(recognizer);
+    }
+    return result;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <model_dir> <file.wav>..." << std::endl;
+        return 1;
+    }
+
+    vosk_set_log_level(-1);
+    VoskModel *model = vosk_model_new(argv[1]);
+    if (!model) {
+        std::cerr << "ERROR: Failed to load Vosk model from \"" << argv[1] << "\"" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::vector<short>> corpus;
+    double audio_seconds = 0.0;
+    for (int i = 2; i < argc; ++i) {
+        std::vector<short> audio;
+        int rate = 0;
+        if (!readWavFile(argv[i], audio, rate)) continue;
+        if (rate != SAMPLE_RATE) {
+            std::cerr << "WARNING: Skipping \"" << argv[i] << "\" (" << rate << " Hz, need " << SAMPLE_RATE << ")" << std::endl;
+            continue;
+        }
+        audio_seconds += audio.size() / (double)SAMPLE_RATE;
+        corpus.push_back(std::move(audio));
+    }
+    if (corpus.empty()) {
+        std::cerr << "ERROR: No usable audio." << std::endl;
+        vosk_model_free(model);
+        return 1;
+    }
+
+    struct Cadence { PartialMode mode; unsigned long interval_ms; };
+    const Cadence cadences[] = {
+        {PartialMode::EVERY_BLOCK, 0},
+        {PartialMode::TIME, 100},
+        {PartialMode::CHANGE, 100},
+        {PartialMode::TIME, 250},
+        {PartialMode::DISABLED, 0},
+    };
+    const size_t chunks[] = {FRAMES_PER_BUFFER, SAMPLE_RATE * COALESCE_MS / 1000};
+
+    std::cout << "Corpus: " << corpus.size() << " file(s), " << std::fixed << std::setprecision(1)
+              << audio_seconds << " s of audio" << std::endl;
+    for (bool live : {true, false}) {
+        std::cout << "\n=== " << (live ? "Live path (gate + HPF + AGC)" : "File path (raw audio)") << " ===" << std::endl;
+        std::cout << std::left << std::setw(18) << "cadence" << std::setw(10) << "chunk"
+                  << std::right << std::setw(10) << "cpu s" << std::setw(10) << "RTF"
+                  << std::setw(10) << "polled" << std::setw(10) << "passed" << std::setw(10) << "saved" << std::endl;
+        double baseline = 0.0;
+        for (size_t chunk : chunks) {
+            for (const Cadence& c : cadences) {
+                RunResult r = run(model, corpus, live, c.mode, c.interval_ms, chunk);
+                if (baseline == 0.0) baseline = r.cpu_seconds;
+                std::string name = partialModeName(c.mode);
+                if (c.interval_ms) name += " " + std::to_string(c.interval_ms) + "ms";
+                std::cout << std::left << std::setw(18) << name
+                          << std::setw(10) << (std::to_string(chunk * 1000 / SAMPLE_RATE) + "ms")
+                          << std::right << std::setprecision(2) << std::setw(10) << r.cpu_seconds
+                          << std::setprecision(3) << std::setw(10) << r.cpu_seconds / audio_seconds
+                          << std::setw(10) << r.partials_polled << std::setw(10) << r.partials_passed
+                          << std::setprecision(1) << std::setw(9) << 100.0 * (1.0 - r.cpu_seconds / baseline) << "%"
+                          << std::endl;
+            }
+        }
+    }
+
+    vosk_model_free(model);
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "stream_dsp.h"
+#include "pipeline.h"
+#include "wav_reader.h"
+
+// Checks that the predefined Pipeline instantiations reproduce the
+// hand-written preprocessing of the live programs, block for block, and
+// compares their speed:
+//   basic     main.cpp / voice_basic.cpp / vb_w_micchoice.cpp (no stages)
+//   buffered  voice_w_cbuff.cpp (processBlock on a StreamDspState)
+// The 48 kHz variant has no hand-written counterpart; its throughput is
+// reported on the source upsampled by 3, and its resampler's gain on a
+// tone in the band and on one that would alias into it.
+//
+// Usage: bench_pipeline [passes] [file.wav]
+//        Without a file a synthetic speech-like signal is used.
+
+#define SAMPLE_RATE         (16000)
+#define FRAMES_PER_BUFFER   (512)
+
+// Bursts of harmonics with pauses, plus a little DC and hum for the HPF
+static std::vector<short> syntheticSource(double seconds) {
+    std::vector<short> audio(static_cast<size_t>(seconds * SAMPLE_RATE));
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < audio.size(); ++i) {
+        double t = i / (double)SAMPLE_RATE;
+        bool voiced = std::fmod(t, 2.3) < 1.4;
+        double v = 300.0 + 60.0 * std::sin(2 * M_PI * 50.0 * t);
+        seed = seed * 1103515245u + 12345u;
+        v += ((seed >> 16) % 200) - 100.0;
+        if (voiced) {
+            double f0 = 120.0 + 30.0 * std::sin(2 * M_PI * 0.7 * t);
+            for (int h = 1; h <= 6; ++h) v += 2500.0 / h * std::sin(2 * M_PI * f0 * h * t);
+        }
+        audio[i] = static_cast<short>(std::max(-32768.0, std::min(32767.0, v)));
+    }
+    return audio;
+}
+
+struct RunResult {
+    double seconds = 0.0;
+    uint64_t checksum = 0;     // over every block's result, length and samples
+    uint64_t frames_out = 0;
+};
+
+static void accumulate(RunResult& r, BlockResult result, const short* audio, unsigned long frames) {
+    r.checksum = r.checksum * 131 + static_cast<int>(result) * 7 + frames;
+    r.frames_out += frames;
+    if (result != BlockResult::SPEECH) return;
+    for (unsigned long i = 0; i < frames; ++i) r.checksum = r.checksum * 31 + static_cast<uint16_t>(audio[i]);
+}
+
+// Runs `process(block, frames)` over the source `passes` times. Only the
+// processing is timed; the checksum runs outside the timed region.
+template <class Process>
+static RunResult run(const std::vector<short>& source, int passes, unsigned long block_frames, Process process) {
+    RunResult r;
+    std::vector<short> block(block_frames);
+    for (int p = 0; p < passes; ++p) {
+        for (size_t pos = 0; pos + block_frames <= source.size(); pos += block_frames) {
+            std::copy(source.begin() + pos, source.begin() + pos + block_frames, block.begin());
+            unsigned long frames = block_frames;
+            auto t0 = std::chrono::steady_clock::now();
+            BlockResult result = process(block.data(), frames);
+            r.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            accumulate(r, result, block.data(), frames);
+        }
+    }
+    return r;
+}
+
+// Output level of the 48 kHz resampler for a full-scale-ish tone, in dB
+// relative to the input, skipping the filter's start-up
+static double resampledToneDb(double frequency) {
+    const int rate = 48000;
+    const unsigned long block_frames = FRAMES_PER_BUFFER * 3;
+    StreamDspConfig config;
+    config.sample_rate = SAMPLE_RATE;
+    Pipeline<ResampleStage<48000>> resampler(config);
+    std::vector<short> block(block_frames);
+    double sum = 0.0;
+    uint64_t count = 0;
+    for (int b = 0; b < 40; ++b) {
+        for (unsigned long i = 0; i < block_frames; ++i) {
+            block[i] = static_cast<short>(8000.0 * std::sin(2 * M_PI * frequency * (b * block_frames + i) / rate));
+        }
+        unsigned long frames = block_frames;
+        resampler.process(block.data(), frames);
+        if (b < 2) continue;
+        for (unsigned long i = 0; i < frames; ++i) sum += (double)block[i] * block[i];
+        count += frames;
+    }
+    double rms = count ? std::sqrt(sum / count) : 0.0;
+    return 20.0 * std::log10(std::max(rms, 1e-3) / (8000.0 / std::sqrt(2.0)));
+}
+
+static void report(const char* name, const RunResult& r, const RunResult* reference, double audio_seconds) {
+    std::cout << std::left << std::setw(22) << name << std::right << std::fixed
+              << std::setprecision(3) << std::setw(10) << r.seconds
+              << std::setprecision(0) << std::setw(12) << audio_seconds / r.seconds << "x";
+    if (reference) {
+        std::cout << std::setprecision(2) << std::setw(10) << reference->seconds / r.seconds << "x"
+                  << std::setw(8) << (r.checksum == reference->checksum ? "yes" : "NO");
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char **argv) {
+    int passes = argc > 1 ? atoi(argv[1]) : 20;
+    if (passes <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [passes] [file.wav]" << std::endl;
+        return 1;
+    }
+
+    std::vector<short> source;
+    if (argc > 2) {
+        int rate = 0;
+        if (!readWavFile(argv[2], source, rate)) return 1;
+        if (rate != SAMPLE_RATE) {
+            std::cerr << "ERROR: \"" << argv[2] << "\" is " << rate << " Hz, need " << SAMPLE_RATE << std::endl;
+            return 1;
+        }
+    } else {
+        source = syntheticSource(30.0);
+    }
+    double audio_seconds = passes * (source.size() / FRAMES_PER_BUFFER) * FRAMES_PER_BUFFER / (double)SAMPLE_RATE;
+
+    StreamDspConfig config;
+    config.sample_rate = SAMPLE_RATE;
+
+    std::cout << passes << " passes, " << std::fixed << std::setprecision(1) << audio_seconds
+              << " s of audio, " << FRAMES_PER_BUFFER << "-frame blocks" << std::endl;
+    std::cout << std::left << std::setw(22) << "path" << std::right << std::setw(10) << "dsp s"
+              << std::setw(13) << "x realtime" << std::setw(11) << "speedup" << std::setw(8) << "match" << std::endl;
+
+    RunResult raw = run(source, passes, FRAMES_PER_BUFFER, [](short*, unsigned long&) {
+        return BlockResult::SPEECH;
+    });
+    BasicPipeline basic(config);
+    RunResult basic_r = run(source, passes, FRAMES_PER_BUFFER, [&](short* audio, unsigned long& frames) {
+        return basic.process(audio, frames);
+    });
+    report("basic hand-written", raw, nullptr, audio_seconds);
+    report("basic Pipeline", basic_r, &raw, audio_seconds);
+
+    StreamDspState dsp(config);
+    RunResult hand = run(source, passes, FRAMES_PER_BUFFER, [&](short* audio, unsigned long& frames) {
+        return processBlock(dsp, audio, frames);
+    });
+    BufferedPipeline buffered(config);
+    RunResult buffered_r = run(source, passes, FRAMES_PER_BUFFER, [&](short* audio, unsigned long& frames) {
+        return buffered.process(audio, frames);
+    });
+    report("buffered hand-written", hand, nullptr, audio_seconds);
+    report("buffered Pipeline", buffered_r, &hand, audio_seconds);
+
+    // Same audio at 48 kHz, in blocks of the same duration
+    std::vector<short> source48k(source.size() * 3);
+    for (size_t i = 0; i < source.size(); ++i) {
+        short next = (i + 1 < source.size()) ? source[i + 1] : source[i];
+        for (int k = 0; k < 3; ++k) source48k[i * 3 + k] = static_cast<short>(source[i] + (next - source[i]) * k / 3);
+    }
+    Buffered48kPipeline buffered48k(config);
+    RunResult r48k = run(source48k, passes, FRAMES_PER_BUFFER * 3, [&](short* audio, unsigned long& frames) {
+        return buffered48k.process(audio, frames);
+    });
+    report("48 kHz Pipeline", r48k, nullptr, audio_seconds);
+    std::cout << "48 kHz output: " << r48k.frames_out << " frames at 16 kHz from "
+              << passes * (source48k.size() / (FRAMES_PER_BUFFER * 3)) * FRAMES_PER_BUFFER * 3 << " in" << std::endl;
+    std::cout << "48 kHz resampler: 1 kHz tone " << std::setprecision(1) << resampledToneDb(1000.0)
+              << " dB, 12 kHz tone " << resampledToneDb(12000.0) << " dB (would alias to 4 kHz)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+
+#include "stream_dsp.h"
+#include "rt_thread.h"
+#include "jitter_histogram.h"
+
+// Measures how late a capture-like periodic thread wakes up while other
+// threads load every CPU, once with default scheduling and once with the
+// voice_w_cbuff.cpp real-time options (SCHED_FIFO, CPU pinning, mlockall
+// plus prefault). Each period runs the preprocessing chain on one block,
+// as the PortAudio callback does.
+//
+// Usage: bench_rt_jitter [seconds] [load_threads] [priority] [cpu]
+//        Defaults: 10 s, one load thread per CPU, priority 80, last CPU.
+
+#define SAMPLE_RATE         (16000)
+#define FRAMES_PER_BUFFER   (512)
+
+static std::atomic<bool> g_stop_load(false);
+
+// CPU and memory pressure: arithmetic plus fresh pages every few ms
+static void loadThread() {
+    volatile double x = 0.0;
+    while (!g_stop_load) {
+        size_t bytes = 8 * 1024 * 1024;
+        char* p = static_cast<char*>(malloc(bytes));
+        if (p) {
+            for (size_t i = 0; i < bytes; i += 4096) p[i] = 1;
+            free(p);
+        }
+        for (int i = 0; i < 200000; ++i) x = x + i * 0.5;
+    }
+}
+
+static uint64_t toNs(const timespec& ts) { return ts.tv_sec * 1000000000ull + ts.tv_nsec; }
+
+static void periodicThread(double seconds, bool realtime, int priority, int cpu, JitterHistogram* histogram) {
+    if (realtime) {
+        ThreadRtConfig rt;
+        rt.policy = SCHED_FIFO;
+        rt.priority = priority;
+        rt.cpu = cpu;
+        applyThreadRtConfig(rt, "periodic");
+        prefaultStack(256 * 1024);
+    }
+    StreamDspState dsp;
+    std::vector<short> block(FRAMES_PER_BUFFER);
+    const uint64_t period_ns = (uint64_t)FRAMES_PER_BUFFER * 1000000000ull / SAMPLE_RATE;
+    const uint64_t periods = static_cast<uint64_t>(seconds * 1e9 / period_ns);
+
+    timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (uint64_t p = 0; p < periods; ++p) {
+        next.tv_nsec += period_ns;
+        while (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        histogram->recordDeviation(toNs(now) > toNs(next) ? toNs(now) - toNs(next) : 0);
+
+        for (int i = 0; i < FRAMES_PER_BUFFER; ++i) block[i] = static_cast<short>((i * 37 + p * 11) % 4000 - 2000);
+        processBlock(dsp, block.data(), FRAMES_PER_BUFFER);
+    }
+}
+
+static JitterHistogram run(double seconds, int load_threads, bool realtime, int priority, int cpu) {
+    if (realtime && !lockAndPrefaultMemory(256 * 1024, 16 * 1024 * 1024)) {
+        std::cerr << "WARNING: Continuing without locked memory." << std::endl;
+    }
+    g_stop_load = false;
+    std::vector<std::thread> load;
+    for (int i = 0; i < load_threads; ++i) load.emplace_back(loadThread);
+
+    JitterHistogram histogram;
+    std::thread periodic(periodicThread, seconds, realtime, priority, cpu, &histogram);
+    periodic.join();
+
+    g_stop_load = true;
+    for (std::thread& t : load) t.join();
+    if (realtime) munlockall();
+    return histogram;
+}
+
+int main(int argc, char **argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 10.0;
+    int cpus = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+    int load_threads = argc > 2 ? atoi(argv[2]) : cpus;
+    int priority = argc > 3 ? atoi(argv[3]) : 80;
+    int cpu = argc > 4 ? atoi(argv[4]) : cpus - 1;
+    if (seconds <= 0 || load_threads < 0) {
+        std::cerr << "Usage: " << argv[0] << " [seconds] [load_threads] [priority] [cpu]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wakeup lateness of a " << FRAMES_PER_BUFFER * 1000 / SAMPLE_RATE << " ms periodic thread, "
+              << seconds << " s per run, " << load_threads << " load thread(s) on " << cpus << " CPU(s)" << std::endl;
+
+    JitterHistogram plain = run(seconds, load_threads, false, priority, cpu);
+    plain.print(std::cout, "\nDefault scheduling");
+
+    JitterHistogram rt = run(seconds, load_threads, true, priority, cpu);
+    std::string title = "\nSCHED_FIFO " + std::to_string(priority) + ", CPU " + std::to_string(cpu) + ", mlockall";
+    rt.print(std::cout, title.c_str());
+    return 0;
+}
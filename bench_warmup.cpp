@@ -0,0 +1,126 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "vosk_api.h"
+#include "recognizer_pool.h"
+#include "wav_reader.h"
+
+// First-utterance latency of a fresh process, with and without warm-up.
+//
+// Each mode runs in its own child process, so lazy allocations and page
+// faults start from scratch every time (a first child only loads the model
+// to bring its files into the page cache). The child loads the model,
+// creates a recognizer, optionally warms it with synthetic audio, then
+// times every accept_waveform call over the file. Latency is what a live
+// stream would see: blocks arrive every 32 ms, the decoder takes them in
+// order, and the latency of an utterance is the time from the arrival of
+// the block that completes it to its final result.
+//
+// Usage: bench_warmup <model_dir> <file.wav> [warmup_seconds]
+
+#define SAMPLE_RATE         (16000)
+#define FRAMES_PER_BUFFER   (512)
+#define UTTERANCES_SHOWN    (3)
+
+static double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Returns the latency of each utterance's final result in ms
+static std::vector<double> decodeLive(VoskRecognizer* recognizer, const std::vector<short>& audio) {
+    const double block_ms = 1000.0 * FRAMES_PER_BUFFER / SAMPLE_RATE;
+    std::vector<double> latencies;
+    double decoder_free_at = 0.0;
+    size_t block = 0;
+    for (size_t pos = 0; pos + FRAMES_PER_BUFFER <= audio.size(); pos += FRAMES_PER_BUFFER, ++block) {
+        auto start = std::chrono::steady_clock::now();
+        bool final = vosk_recognizer_accept_waveform_s(recognizer, audio.data() + pos, FRAMES_PER_BUFFER) > 0;
+        if (final) vosk_recognizer_result(recognizer);
+        double arrival = (block + 1) * block_ms;
+        decoder_free_at = std::max(decoder_free_at, arrival) + msSince(start);
+        if (final) latencies.push_back(decoder_free_at - arrival);
+    }
+    auto start = std::chrono::steady_clock::now();
+    vosk_recognizer_final_result(recognizer);
+    double arrival = block * block_ms;
+    decoder_free_at = std::max(decoder_free_at, arrival) + msSince(start);
+    latencies.push_back(decoder_free_at - arrival);
+    return latencies;
+}
+
+static void runChild(const char* model_dir, const std::vector<short>& audio, double warmup_seconds, bool report) {
+    vosk_set_log_level(-1);
+    VoskModel* model = vosk_model_new(model_dir);
+    if (!model) {
+        std::cerr << "ERROR: Failed to load Vosk model from \"" << model_dir << "\"" << std::endl;
+        _exit(1);
+    }
+    if (!report) {
+        vosk_model_free(model);
+        _exit(0);
+    }
+    VoskRecognizer* recognizer = vosk_recognizer_new(model, (float)SAMPLE_RATE);
+    if (!recognizer) _exit(1);
+    double warmup_ms = 0.0;
+    if (warmup_seconds > 0) warmup_ms = warmUpRecognizer(recognizer, generateWarmupAudio(warmup_seconds, SAMPLE_RATE));
+    std::vector<double> latencies = decodeLive(recognizer, audio);
+
+    std::cout << std::left << std::setw(10) << (warmup_seconds > 0 ? "warm" : "cold") << std::right
+              << std::fixed << std::setprecision(0) << std::setw(12) << warmup_ms;
+    std::cout << std::setprecision(1);
+    for (size_t i = 0; i < UTTERANCES_SHOWN; ++i) {
+        std::cout << std::setw(12);
+        if (i < latencies.size()) std::cout << latencies[i];
+        else std::cout << "-";
+    }
+    std::cout << std::endl;
+    vosk_recognizer_free(recognizer);
+    vosk_model_free(model);
+    _exit(0);
+}
+
+static bool runInChild(const char* model_dir, const std::vector<short>& audio, double warmup_seconds, bool report) {
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) runChild(model_dir, audio, warmup_seconds, report);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <model_dir> <file.wav> [warmup_seconds]" << std::endl;
+        return 1;
+    }
+    double warmup_seconds = argc > 3 ? atof(argv[3]) : 3.0;
+    if (warmup_seconds <= 0) {
+        std::cerr << "ERROR: warmup_seconds must be positive." << std::endl;
+        return 1;
+    }
+    std::vector<short> audio;
+    int rate = 0;
+    if (!readWavFile(argv[2], audio, rate)) return 1;
+    if (rate != SAMPLE_RATE) {
+        std::cerr << "ERROR: Need " << SAMPLE_RATE << " Hz audio, got " << rate << " Hz." << std::endl;
+        return 1;
+    }
+
+    if (!runInChild(argv[1], audio, 0.0, false)) return 1;   // page cache only
+
+    std::cout << "Final-result latency per utterance (ms), " << warmup_seconds << " s warm-up" << std::endl;
+    std::cout << std::left << std::setw(10) << "mode" << std::right << std::setw(12) << "warmup ms";
+    for (int i = 1; i <= UTTERANCES_SHOWN; ++i) std::cout << std::setw(11) << "utt " << i;
+    std::cout << std::endl;
+    if (!runInChild(argv[1], audio, 0.0, true)) return 1;
+    if (!runInChild(argv[1], audio, warmup_seconds, true)) return 1;
+    return 0;
+}
@@ -0,0 +1,96 @@
+// Hands processed capture blocks from the PortAudio callback to the decoder
+// thread.
+//
+// Single producer, single consumer, fixed capacity. The ring holds
+// references to pooled AudioBlocks (see audio_block.h), not samples: the
+// callback preprocesses straight into a pool block and moves the reference
+// in, and the decoder moves it out, so audio is never copied on the way.
+// The slots are allocated up front and the producer never blocks, locks or
+// allocates, so push() is safe in the audio callback. When the decoder
+// falls behind by `capacity` blocks, new blocks are dropped and counted.
+// The consumer sleeps on a POSIX semaphore, which the producer posts per
+// block (sem_post is async-signal-safe and does not take a lock).
+
+#ifndef BLOCK_RING_H
+#define BLOCK_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <semaphore.h>
+
+#include "audio_block.h"
+
+class BlockRing {
+private:
+    size_t capacity;
+    std::vector<AudioBlockRef> slots;
+    sem_t ready;
+
+    alignas(64) std::atomic<uint64_t> head{0};      // next slot to fill (producer)
+    std::atomic<uint64_t> dropped{0};
+    alignas(64) std::atomic<uint64_t> tail{0};      // next slot to read (consumer)
+
+public:
+    explicit BlockRing(size_t blocks) : capacity(blocks), slots(blocks) {
+        sem_init(&ready, 0, 0);
+    }
+    ~BlockRing() { sem_destroy(&ready); }
+
+    BlockRing(const BlockRing&) = delete;
+    BlockRing& operator=(const BlockRing&) = delete;
+
+    // Producer: true if there is room for another block
+    bool hasSpace() const {
+        return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire) < capacity;
+    }
+
+    // Producer: queues the block. Returns false (and counts a drop) if the
+    // ring is full; the block is then left with the caller.
+    bool push(AudioBlockRef& block) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= capacity) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        slots[h % capacity] = std::move(block);
+        head.store(h + 1, std::memory_order_release);
+        sem_post(&ready);
+        return true;
+    }
+
+    // Producer: a block was lost before it reached the ring
+    void noteDropped() { dropped.fetch_add(1, std::memory_order_relaxed); }
+
+    // Consumer: sleeps until a block was pushed or wake() was called
+    void wait() {
+        while (sem_wait(&ready) != 0) {}   // retry on EINTR
+    }
+
+    // Wakes the consumer without a block, e.g. to let it see a stop flag
+    void wake() { sem_post(&ready); }
+
+    // Consumer: sequence number of the oldest block, if any
+    bool frontSequence(uint64_t& sequence) const {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        sequence = slots[t % capacity]->sequence;
+        return true;
+    }
+
+    // Consumer: takes the oldest block, if any
+    bool pop(AudioBlockRef& block) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        block = std::move(slots[t % capacity]);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+    uint64_t droppedBlocks() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+#endif // BLOCK_RING_H
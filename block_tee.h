@@ -0,0 +1,89 @@
+// Fans one stream of AudioBlockRefs out to several consumers.
+//
+// publish() appends the same reference to every consumer's queue - the
+// samples are never copied - and each consumer pops at its own pace on its
+// own thread. Each consumer has a fixed-capacity BlockRing (block_ring.h)
+// allocated at construction, so blocks flow through without malloc/free.
+// Queues are bounded: the producer waits while any consumer is `capacity`
+// blocks behind, so a slow consumer holds back the producer instead of
+// growing memory. close() ends the stream; consumers drain what is queued
+// and then get false from pop().
+//
+// Not for the audio callback (publish() blocks); use BlockRing there.
+
+#ifndef BLOCK_TEE_H
+#define BLOCK_TEE_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <semaphore.h>
+
+#include "audio_block.h"
+#include "block_ring.h"
+
+class BlockTee {
+private:
+    std::vector<std::unique_ptr<BlockRing>> queues;
+    std::atomic<bool> closed{false};
+    std::atomic<bool> producer_waiting{false};
+    sem_t space;    // posted by the consumer that clears producer_waiting
+
+    bool anyFull() const {
+        for (const auto& q : queues) if (!q->hasSpace()) return true;
+        return false;
+    }
+
+public:
+    BlockTee(size_t consumers, size_t capacity_blocks) {
+        for (size_t i = 0; i < consumers; ++i) queues.emplace_back(new BlockRing(capacity_blocks));
+        sem_init(&space, 0, 0);
+    }
+    ~BlockTee() { sem_destroy(&space); }
+
+    BlockTee(const BlockTee&) = delete;
+    BlockTee& operator=(const BlockTee&) = delete;
+
+    size_t consumerCount() const { return queues.size(); }
+
+    // Single producer
+    void publish(const AudioBlockRef& block) {
+        while (anyFull()) {
+            // Raised with an RMW: a consumer whose exchange came first
+            // synchronizes with it, so its pop is seen by the re-check. If
+            // room appeared but a consumer still took the flag, its post is
+            // consumed here, so no stale credit is left over.
+            producer_waiting.exchange(true);
+            if (anyFull() || !producer_waiting.exchange(false)) {
+                while (sem_wait(&space) != 0) {}   // retry on EINTR
+            }
+        }
+        for (auto& q : queues) {
+            AudioBlockRef ref = block;
+            q->push(ref);
+        }
+    }
+
+    // Waits for the consumer's next block. Returns false once the tee is
+    // closed and the consumer's queue is drained.
+    bool pop(size_t consumer, AudioBlockRef& block) {
+        BlockRing& q = *queues[consumer];
+        while (true) {
+            // Read before popping: once closed, every block is already queued
+            bool done = closed.load(std::memory_order_acquire);
+            if (q.pop(block)) {
+                if (producer_waiting.exchange(false)) sem_post(&space);   // only if it waits
+                return true;
+            }
+            if (done) return false;
+            q.wait();
+        }
+    }
+
+    void close() {
+        closed.store(true, std::memory_order_release);
+        for (auto& q : queues) q->wake();
+    }
+};
+
+#endif // BLOCK_TEE_H
@@ -0,0 +1,83 @@
+// Decides when a stream's decoder is catching up on a backlog.
+//
+// After a stall (a slow disk, a CPU spike, a suspended laptop) the decoder
+// can be seconds behind capture. Partials for that audio are stale before
+// they are printed, and small chunks pay the per-call decoder overhead
+// exactly when CPU matters most. While catching up the caller should skip
+// partials and feed the largest chunks it can, then switch back to low
+// latency once the backlog is drained.
+//
+// Hysteresis keeps the mode from flapping: it starts when the backlog
+// reaches enter_blocks and ends only once it is down to exit_blocks. Each
+// episode is timed, so the caller can report how long catching up took and
+// how much faster than real time the audio was decoded.
+
+#ifndef CATCH_UP_H
+#define CATCH_UP_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+class CatchUpTracker {
+public:
+    enum class Change { NONE, ENTERED, LEFT };
+
+private:
+    size_t enter_blocks;
+    size_t exit_blocks;
+    bool catching_up = false;
+    std::chrono::steady_clock::time_point started;
+
+    uint64_t episode_frames = 0;     // audio decoded in the current/last episode
+    double episode_seconds = 0.0;    // length of the last finished episode
+    unsigned long episode_count = 0;
+    double total_seconds = 0.0;
+    double longest_seconds = 0.0;
+    uint64_t total_frames = 0;
+
+public:
+    CatchUpTracker(size_t enter, size_t exit) : enter_blocks(enter), exit_blocks(std::min(exit, enter)) {}
+
+    // Call before each block with the number of blocks still waiting
+    Change update(size_t backlog_blocks) {
+        if (!catching_up && enter_blocks > 0 && backlog_blocks >= enter_blocks) {
+            catching_up = true;
+            started = std::chrono::steady_clock::now();
+            episode_frames = 0;
+            episode_count++;
+            return Change::ENTERED;
+        }
+        if (catching_up && backlog_blocks <= exit_blocks) {
+            catching_up = false;
+            episode_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            total_seconds += episode_seconds;
+            longest_seconds = std::max(longest_seconds, episode_seconds);
+            return Change::LEFT;
+        }
+        return Change::NONE;
+    }
+
+    // Call with the frames of every block decoded
+    void onDecoded(unsigned long frames) {
+        if (!catching_up) return;
+        episode_frames += frames;
+        total_frames += frames;
+    }
+
+    bool active() const { return catching_up; }
+
+    // The current episode, or the last one once it has ended
+    uint64_t episodeFrames() const { return episode_frames; }
+    double episodeSeconds() const {
+        return catching_up ? std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count()
+                           : episode_seconds;
+    }
+
+    unsigned long episodes() const { return episode_count; }
+    double totalSeconds() const { return total_seconds + (catching_up ? episodeSeconds() : 0.0); }
+    double longestSeconds() const { return std::max(longest_seconds, catching_up ? episodeSeconds() : 0.0); }
+    uint64_t totalFrames() const { return total_frames; }
+};
+
+#endif // CATCH_UP_H
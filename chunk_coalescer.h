@@ -0,0 +1,65 @@
+// Collects small capture blocks into larger chunks before they are handed
+// to vosk_recognizer_accept_waveform_s(). Every accept call pays a fixed
+// cost (feature pipeline bookkeeping, decoder advance, endpoint checks), so
+// feeding 100-200 ms at a time instead of 32 ms cuts decode CPU when the
+// stream can tolerate the extra delay.
+//
+// A latency cap bounds that delay: a chunk is also released once its
+// oldest sample has waited max_delay frames of capture time, even if it
+// is not full. This matters when the gate stops the flow in the middle of
+// a chunk, since no further blocks would otherwise push it out. Times are
+// capture positions in frames, so the same logic works for live streams
+// and for replayed files.
+
+#ifndef CHUNK_COALESCER_H
+#define CHUNK_COALESCER_H
+
+#include <cstdint>
+#include <vector>
+
+class ChunkCoalescer {
+private:
+    std::vector<short> pending;
+    size_t chunk_frames;
+    uint64_t max_delay_frames;   // 0: no cap
+    uint64_t oldest_frame = 0;   // capture position of pending[0]
+
+public:
+    // chunk_frames <= 1 passes every block straight through
+    explicit ChunkCoalescer(size_t frames, uint64_t max_delay = 0)
+        : chunk_frames(frames), max_delay_frames(max_delay) {
+        pending.reserve(frames * 2);
+    }
+
+    // Appends a block that ends at capture position `now_frame`. Returns
+    // true once a chunk is ready in data()/size().
+    bool push(const short* data, size_t len, uint64_t now_frame) {
+        if (pending.empty()) oldest_frame = now_frame - len;
+        pending.insert(pending.end(), data, data + len);
+        return due(now_frame);
+    }
+
+    // True if the pending audio must be fed now: the chunk is full or its
+    // oldest sample reached the latency cap.
+    bool due(uint64_t now_frame) const {
+        if (pending.empty()) return false;
+        if (pending.size() >= chunk_frames) return true;
+        return max_delay_frames > 0 && now_frame - oldest_frame >= max_delay_frames;
+    }
+
+    const short* data() const { return pending.data(); }
+    size_t size() const { return pending.size(); }
+    bool empty() const { return pending.empty(); }
+
+    // Capture position of the oldest pending sample
+    uint64_t oldestFrame() const { return oldest_frame; }
+
+    // Call after the chunk was fed to the recognizer.
+    void consume() { pending.clear(); }
+
+    void setChunkFrames(size_t frames) { chunk_frames = frames; }
+    size_t getChunkFrames() const { return chunk_frames; }
+    void setMaxDelayFrames(uint64_t frames) { max_delay_frames = frames; }
+};
+
+#endif // CHUNK_COALESCER_H
@@ -0,0 +1,49 @@
+// Client-side endpointer driven by the noise gate.
+//
+// The noise gate keeps silent blocks away from the recognizer, so Vosk's
+// own endpointer never sees the pause after an utterance and the final
+// result only arrives once the next utterance starts. The endpointer counts
+// gated audio instead and tells the caller to force a final result with
+// vosk_recognizer_final_result() once the silence is long enough.
+
+#ifndef ENDPOINTER_H
+#define ENDPOINTER_H
+
+class Endpointer {
+private:
+    unsigned long silence_frames_needed;
+    unsigned long silent_frames = 0;
+    bool in_utterance = false;   // speech fed since the last final result
+    int sample_rate;
+
+public:
+    // silence_ms == 0 disables forced finals
+    Endpointer(unsigned long silence_ms, int rate)
+        : silence_frames_needed(silence_ms * rate / 1000), sample_rate(rate) {}
+
+    // A block passed the gate and was fed to the recognizer
+    void onSpeech() {
+        silent_frames = 0;
+        in_utterance = true;
+    }
+
+    // A block was gated. Returns true when the caller should force a final.
+    bool onSilence(unsigned long frames) {
+        if (!in_utterance || silence_frames_needed == 0) return false;
+        silent_frames += frames;
+        if (silent_frames < silence_frames_needed) return false;
+        in_utterance = false;
+        return true;
+    }
+
+    // The recognizer produced a final on its own
+    void onFinal() {
+        in_utterance = false;
+        silent_frames = 0;
+    }
+
+    bool inUtterance() const { return in_utterance; }
+    unsigned long silenceMs() const { return silent_frames * 1000 / sample_rate; }
+};
+
+#endif // ENDPOINTER_H
@@ -0,0 +1,164 @@
+// Builds the JSON grammar passed to vosk_recognizer_new_grm() /
+// vosk_recognizer_set_grm() from a plain list of phrases.
+//
+// Hand-written grammar strings are easy to get wrong: a missing comma
+// between two quoted entries silently glues them together, and words the
+// model does not know are dropped by Vosk with nothing more than a log
+// line. The builder normalizes and deduplicates the phrases, checks every
+// word once against vosk_model_find_word() and reports what it had to drop.
+//
+// Model lookups are cached by word, so large phrase lists that reuse the
+// same vocabulary only pay for each distinct word once, and the cache is
+// kept across clear() for grammars rebuilt against the same model.
+
+#ifndef GRAMMAR_BUILDER_H
+#define GRAMMAR_BUILDER_H
+
+#include <cctype>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "vosk_api.h"
+
+struct GrammarReport {
+    size_t phrases_in = 0;         // phrases passed to addPhrase()
+    size_t duplicates = 0;         // dropped because already present
+    size_t dropped_oov = 0;        // dropped because a word is not in the model
+    size_t model_lookups = 0;      // calls made to vosk_model_find_word()
+    std::vector<std::string> oov_words;  // distinct unknown words, first-seen order
+    double build_ms = 0.0;
+};
+
+class GrammarBuilder {
+private:
+    VoskModel *model;
+    bool keep_oov_phrases;
+    bool add_unk;
+    std::unordered_map<std::string, bool> word_known;  // survives clear()
+    std::unordered_set<std::string> seen;
+    std::unordered_set<std::string> oov_seen;
+    std::vector<std::string> phrases;
+    GrammarReport report;
+    std::chrono::steady_clock::duration elapsed{};
+    std::string norm;   // scratch buffers reused across phrases
+    std::string word;
+
+    bool isKnown(const std::string& word) {
+        auto it = word_known.find(word);
+        if (it != word_known.end()) return it->second;
+        report.model_lookups++;
+        bool known = vosk_model_find_word(model, word.c_str()) >= 0;
+        word_known.emplace(word, known);
+        return known;
+    }
+
+    static void appendJsonString(std::string& out, const std::string& s) {
+        out += '"';
+        for (char c : s) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        out += '"';
+    }
+
+public:
+    // keep_oov: keep phrases with unknown words (Vosk ignores those words)
+    // instead of dropping them. unk: append "[unk]" so out-of-grammar speech
+    // is reported as such rather than forced onto the closest phrase.
+    explicit GrammarBuilder(VoskModel *m, bool keep_oov = false, bool unk = true)
+        : model(m), keep_oov_phrases(keep_oov), add_unk(unk) {}
+
+    // Lower-cases the phrase, keeps letters, digits and apostrophes, and
+    // collapses everything else to single spaces.
+    static void normalize(const std::string& phrase, std::string& out) {
+        out.clear();
+        for (unsigned char c : phrase) {
+            if (std::isalnum(c) || c == '\'' || c >= 0x80) {
+                out += static_cast<char>(std::tolower(c));
+            } else if (!out.empty() && out.back() != ' ') {
+                out += ' ';
+            }
+        }
+        if (!out.empty() && out.back() == ' ') out.pop_back();
+    }
+
+    // Returns true if the phrase was added to the grammar.
+    bool addPhrase(const std::string& phrase) {
+        report.phrases_in++;
+        normalize(phrase, norm);
+        bool added = false;
+        if (norm.empty()) {
+            return false;
+        } else if (!seen.insert(norm).second) {
+            report.duplicates++;
+        } else {
+            bool all_known = true;
+            size_t begin = 0;
+            while (begin < norm.size()) {
+                size_t end = norm.find(' ', begin);
+                if (end == std::string::npos) end = norm.size();
+                // Check every word so the OOV report is complete
+                word.assign(norm, begin, end - begin);
+                if (!isKnown(word)) {
+                    all_known = false;
+                    if (oov_seen.insert(word).second) report.oov_words.push_back(word);
+                }
+                begin = end + 1;
+            }
+            if (all_known || keep_oov_phrases) {
+                phrases.push_back(norm);
+                added = true;
+            } else {
+                report.dropped_oov++;
+            }
+        }
+        return added;
+    }
+
+    void addPhrases(const std::vector<std::string>& list) {
+        auto start = std::chrono::steady_clock::now();
+        phrases.reserve(phrases.size() + list.size());
+        seen.reserve(seen.size() + list.size());
+        for (const std::string& p : list) addPhrase(p);
+        elapsed += std::chrono::steady_clock::now() - start;
+    }
+
+    // Compact JSON array for vosk_recognizer_new_grm()
+    std::string json() {
+        auto start = std::chrono::steady_clock::now();
+        size_t bytes = 2;
+        for (const std::string& p : phrases) bytes += p.size() + 3;
+        std::string out;
+        out.reserve(bytes + 8);
+        out += '[';
+        for (const std::string& p : phrases) {
+            if (out.size() > 1) out += ',';
+            appendJsonString(out, p);
+        }
+        if (add_unk) {
+            if (out.size() > 1) out += ',';
+            out += "\"[unk]\"";
+        }
+        out += ']';
+        elapsed += std::chrono::steady_clock::now() - start;
+        report.build_ms = std::chrono::duration<double, std::milli>(elapsed).count();
+        return out;
+    }
+
+    const GrammarReport& getReport() const { return report; }
+    size_t phraseCount() const { return phrases.size(); }
+
+    // Starts a new grammar; cached model lookups are kept.
+    void clear() {
+        seen.clear();
+        oov_seen.clear();
+        phrases.clear();
+        report = GrammarReport();
+        elapsed = std::chrono::steady_clock::duration();
+    }
+};
+
+#endif // GRAMMAR_BUILDER_H
@@ -0,0 +1,176 @@
+// Low-wakeup idle path for a capture stream.
+//
+// In silence the capture path still costs a full noise gate per callback,
+// a semaphore post and a decoder wakeup per block, and the main thread
+// polls on a timer. On battery or a small edge board that keeps the CPU
+// out of its deep idle states for nothing.
+//
+// Once a stream has been quiet outside an utterance for `enter_frames`,
+// the gate goes idle: the callback only checks a decimated energy
+// estimate (every `decimation`-th sample) and queues nothing, so the
+// decoder stays asleep on its queue. A block whose decimated RMS reaches
+// `wake_rms` is checked with the full gate; if that hears speech, the gate
+// turns active before the block is queued. Blocks skipped while idle keep
+// their capture sequence numbers, so the decoder still accounts them as
+// (unfed) capture time.
+//
+// WakeEvent lets a thread sleep until something happens instead of
+// polling: notify() is a counter bump plus FUTEX_WAKE, cheap enough for
+// the audio callback when it is rare (e.g. a backlog threshold crossed).
+
+#ifndef IDLE_GATE_H
+#define IDLE_GATE_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "stream_dsp.h"
+
+// Sleeps while `word` holds `expected`, at most timeout_ms (-1: no limit).
+// May return early (signal, spurious wake); callers re-check their condition.
+inline void futexWait(std::atomic<uint32_t>& word, uint32_t expected, long timeout_ms = -1) {
+    struct timespec ts;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+    }
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected,
+            timeout_ms >= 0 ? &ts : nullptr, nullptr, 0);
+}
+
+inline void futexWake(std::atomic<uint32_t>& word, int waiters = INT_MAX) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, waiters, nullptr, nullptr, 0);
+}
+
+inline double processCpuSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// RMS of every `step`-th sample above `threshold`; no sqrt, no full pass
+inline bool isDecimatedAboveLevel(const short* audio, unsigned long frames, unsigned step, double threshold) {
+    int64_t sum = 0;
+    unsigned long count = 0;
+    for (unsigned long i = 0; i < frames; i += step, ++count) {
+        sum += audio[i] * audio[i];
+    }
+    return count > 0 && (double)sum > threshold * threshold * count;
+}
+
+// Something for a sleeping thread to look at
+class WakeEvent {
+private:
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint64_t> wakeup_count{0};
+
+public:
+    // Read before checking state; wait() returns at once if notified since
+    uint32_t current() const { return sequence.load(std::memory_order_acquire); }
+
+    void notify() {
+        sequence.fetch_add(1, std::memory_order_acq_rel);
+        futexWake(sequence);
+    }
+
+    // Sleeps until notified after `seen`, or timeout_ms (-1: no limit)
+    void wait(uint32_t seen, long timeout_ms = -1) {
+        futexWait(sequence, seen, timeout_ms);
+        wakeup_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t wakeups() const { return wakeup_count.load(std::memory_order_relaxed); }
+};
+
+// Idle periods and what ran during them. Each field has one writer:
+// whichever thread ends a period, the decoder and the main thread.
+struct IdleStats {
+    unsigned long periods = 0;
+    double seconds = 0.0;           // wall time idle
+    double cpu_seconds = 0.0;       // process CPU while idle
+    uint64_t callbacks = 0;         // capture callbacks while idle
+    uint64_t decoder_wakeups = 0;
+    uint64_t main_wakeups = 0;
+};
+
+class IdleGate {
+private:
+    enum : uint32_t { ACTIVE = 0, IDLE = 1 };
+
+    unsigned long enter_frames;
+    unsigned decimation;
+    double wake_rms;
+    double gate_rms;
+    unsigned long quiet_frames = 0;             // callback thread
+    std::atomic<uint32_t> state{ACTIVE};
+    std::atomic<uint64_t> skipped{0};           // written by the callback only
+    // The open period, set before the gate goes idle
+    std::chrono::steady_clock::time_point entered;
+    double entered_cpu = 0.0;
+    uint64_t entered_skipped = 0;
+    IdleStats stats;
+
+public:
+    // enter_frames == 0 disables idling
+    IdleGate(unsigned long enter, unsigned step, double wake_level, double gate_level)
+        : enter_frames(enter), decimation(step > 0 ? step : 1), wake_rms(wake_level), gate_rms(gate_level) {}
+
+    bool idle() const { return state.load(std::memory_order_acquire) == IDLE; }
+
+    // Callback, while idle: true if the block may hold speech, in which case
+    // the gate is active again. Otherwise the block is counted as skipped
+    // and should be dropped.
+    bool listen(const short* audio, unsigned long frames) {
+        if (isDecimatedAboveLevel(audio, frames, decimation, wake_rms) &&
+            isAudioAboveNoiseGate(audio, frames, gate_rms)) {
+            wake();
+            return true;
+        }
+        skipped.store(skipped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Callback, after the DSP of every block processed while active
+    void onBlock(BlockResult result, bool in_utterance, unsigned long frames) {
+        if (enter_frames == 0) return;
+        if (result == BlockResult::SPEECH || in_utterance) {
+            quiet_frames = 0;
+            return;
+        }
+        quiet_frames += frames;
+        if (quiet_frames >= enter_frames) {
+            quiet_frames = 0;
+            entered = std::chrono::steady_clock::now();
+            entered_cpu = processCpuSeconds();
+            entered_skipped = skippedBlocks();
+            state.store(IDLE, std::memory_order_release);
+        }
+    }
+
+    // Leaves idle and closes the period, e.g. once the callback has stopped
+    void wake() {
+        if (state.exchange(ACTIVE, std::memory_order_acq_rel) != IDLE) return;
+        stats.periods++;
+        stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - entered).count();
+        stats.cpu_seconds += processCpuSeconds() - entered_cpu;
+        stats.callbacks += skippedBlocks() - entered_skipped;
+    }
+
+    // Decoder and main thread: count a wakeup that came while idle
+    void noteDecoderWakeup() { if (idle()) stats.decoder_wakeups++; }
+    void noteMainWakeup() { if (idle()) stats.main_wakeups++; }
+
+    uint64_t skippedBlocks() const { return skipped.load(std::memory_order_relaxed); }
+
+    // Once every thread is done with the gate
+    const IdleStats& getStats() const { return stats; }
+};
+
+#endif // IDLE_GATE_H
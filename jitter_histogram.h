@@ -0,0 +1,80 @@
+// Histogram of how far a periodic thread's wakeups stray from its period,
+// e.g. the PortAudio callback, which should run once per buffer. Only one
+// thread may call record(); read the histogram after that thread stopped.
+
+#ifndef JITTER_HISTOGRAM_H
+#define JITTER_HISTOGRAM_H
+
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <string>
+#include <time.h>
+
+class JitterHistogram {
+public:
+    static constexpr int BUCKETS = 10;
+
+private:
+    // Upper bounds in microseconds; the last bucket is open
+    static constexpr uint64_t BOUNDS_US[BUCKETS - 1] = {50, 100, 250, 500, 1000, 2000, 5000, 10000, 20000};
+
+    uint64_t period_ns = 0;
+    uint64_t last_ns = 0;
+    uint64_t counts[BUCKETS] = {};
+    uint64_t samples = 0;
+    uint64_t max_us = 0;
+
+    static uint64_t nowNs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    }
+
+public:
+    void start(uint64_t expected_period_ns) {
+        period_ns = expected_period_ns;
+        last_ns = 0;
+    }
+
+    // Call at the start of every period; records how far the interval
+    // since the previous call is from the period
+    void record() {
+        uint64_t now = nowNs();
+        uint64_t previous = last_ns;
+        last_ns = now;
+        if (previous == 0) return;
+        uint64_t interval = now - previous;
+        recordDeviation(interval > period_ns ? interval - period_ns : period_ns - interval);
+    }
+
+    // Records a deviation measured by the caller, e.g. lateness against an
+    // absolute deadline
+    void recordDeviation(uint64_t deviation_ns) {
+        uint64_t us = deviation_ns / 1000;
+        int b = 0;
+        while (b < BUCKETS - 1 && us >= BOUNDS_US[b]) ++b;
+        counts[b]++;
+        samples++;
+        if (us > max_us) max_us = us;
+    }
+
+    uint64_t sampleCount() const { return samples; }
+    uint64_t maxUs() const { return max_us; }
+
+    void print(std::ostream& out, const char* title) const {
+        out << title << " (" << samples << " periods, max " << max_us << " us)" << std::endl;
+        uint64_t lower = 0;
+        for (int b = 0; b < BUCKETS; ++b) {
+            std::string range = (b < BUCKETS - 1)
+                ? std::to_string(lower) + "-" + std::to_string(BOUNDS_US[b]) + " us"
+                : ">= " + std::to_string(lower) + " us";
+            double pct = samples ? 100.0 * counts[b] / samples : 0.0;
+            out << "  " << std::left << std::setw(16) << range << std::right << std::setw(10) << counts[b]
+                << std::fixed << std::setprecision(2) << std::setw(9) << pct << "%" << std::endl;
+            if (b < BUCKETS - 1) lower = BOUNDS_US[b];
+        }
+    }
+};
+
+#endif // JITTER_HISTOGRAM_H
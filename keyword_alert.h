@@ -0,0 +1,287 @@
+// Real-time keyword alerting over Vosk partial and final results.
+//
+// The watch list is compiled into a word-level Aho-Corasick automaton, so
+// the cost of scanning a result does not depend on how many phrases are
+// watched. The automaton is stored flat:
+//
+//   - states are numbered in BFS order, so the shallow states that almost
+//     every step touches sit together at the front of the arrays;
+//   - the root, which is where the scan sits most of the time, has a dense
+//     transition array indexed by word id;
+//   - every other state keeps its outgoing edges as a sorted slice of one
+//     shared (word, target) array, searched with a short binary search;
+//   - failure links and the flattened output lists (own matches plus every
+//     match reachable through failure links) are plain arrays as well.
+//
+// Words that never appear in the watch list map to a single "unknown" id,
+// which has no edges anywhere and sends the scan straight back to the root.
+//
+// KeywordScanner keeps the scan state per utterance. A new partial only
+// advances the automaton over the words that were not seen before; if
+// Vosk revises the tail of the partial, the scan rewinds to the last word
+// that is still unchanged.
+
+#ifndef KEYWORD_ALERT_H
+#define KEYWORD_ALERT_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "vosk_result.h"
+
+struct KeywordAlert {
+    uint32_t phrase_id;
+    const std::string* phrase;  // owned by the automaton
+    double start;               // recognizer seconds of the first word, -1 if unknown
+    double end;                 // recognizer seconds of the last word, -1 if unknown
+    bool from_final;            // detected in a final rather than a partial result
+};
+
+class KeywordAutomaton {
+private:
+    static constexpr uint32_t UNKNOWN_WORD = 0;  // id 0 is reserved for words outside the watch list
+    static constexpr uint32_t ROOT = 0;
+
+    std::unordered_map<std::string, uint32_t> vocab;
+    std::vector<std::string> phrases;
+    std::vector<uint32_t> phrase_len;
+    std::vector<std::vector<uint32_t>> pending;  // tokenized phrases awaiting compile()
+
+    std::vector<uint32_t> root_next;    // indexed by word id
+    std::vector<uint32_t> edge_begin;   // per state; edges of s are [edge_begin[s], edge_begin[s+1])
+    std::vector<uint32_t> edge_word;
+    std::vector<uint32_t> edge_target;
+    std::vector<uint32_t> fail;
+    std::vector<uint32_t> out_begin;    // per state; outputs of s are [out_begin[s], out_begin[s+1])
+    std::vector<uint32_t> out_phrase;
+
+    static std::string normalize(const std::string& word) {
+        std::string w(word);
+        std::transform(w.begin(), w.end(), w.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return w;
+    }
+
+    uint32_t goTo(uint32_t state, uint32_t word) const {
+        if (state == ROOT) return root_next[word];
+        const uint32_t* first = edge_word.data() + edge_begin[state];
+        const uint32_t* last = edge_word.data() + edge_begin[state + 1];
+        const uint32_t* it = std::lower_bound(first, last, word);
+        if (it == last || *it != word) return UINT32_MAX;
+        return edge_target[it - edge_word.data()];
+    }
+
+public:
+    KeywordAutomaton() { vocab.emplace(std::string(), UNKNOWN_WORD); }
+
+    // Adds one phrase; words are split on whitespace and lower-cased.
+    // Returns false for empty phrases.
+    bool addPhrase(const std::string& phrase) {
+        std::vector<uint32_t> ids;
+        std::istringstream tokens(phrase);
+        std::string token;
+        std::string normalized;
+        while (tokens >> token) {
+            token = normalize(token);
+            auto it = vocab.emplace(token, static_cast<uint32_t>(vocab.size())).first;
+            ids.push_back(it->second);
+            normalized += normalized.empty() ? token : " " + token;
+        }
+        if (ids.empty()) return false;
+        phrases.push_back(normalized);
+        phrase_len.push_back(static_cast<uint32_t>(ids.size()));
+        pending.push_back(std::move(ids));
+        return true;
+    }
+
+    // Reads one phrase per line; blank lines and lines starting with '#' are skipped.
+    bool loadFile(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) return false;
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t first = line.find_first_not_of(" \t");
+            if (first == std::string::npos || line[first] == '#') continue;
+            addPhrase(line);
+        }
+        return true;
+    }
+
+    // Builds the flat tables. Must be called after the last addPhrase().
+    void compile() {
+        // Temporary pointer-free trie: children kept in ordered maps
+        std::vector<std::map<uint32_t, uint32_t>> children(1);
+        std::vector<std::vector<uint32_t>> own_out(1);
+        for (size_t p = 0; p < pending.size(); ++p) {
+            uint32_t s = 0;
+            for (uint32_t w : pending[p]) {
+                auto it = children[s].find(w);
+                if (it == children[s].end()) {
+                    uint32_t next = static_cast<uint32_t>(children.size());
+                    children[s].emplace(w, next);
+                    children.emplace_back();
+                    own_out.emplace_back();
+                    s = next;
+                } else {
+                    s = it->second;
+                }
+            }
+            own_out[s].push_back(static_cast<uint32_t>(p));
+        }
+
+        // Renumber states in BFS order
+        size_t n = children.size();
+        std::vector<uint32_t> order;
+        std::vector<uint32_t> new_id(n);
+        order.reserve(n);
+        order.push_back(0);
+        for (size_t i = 0; i < order.size(); ++i) {
+            new_id[order[i]] = static_cast<uint32_t>(i);
+            for (const auto& c : children[order[i]]) order.push_back(c.second);
+        }
+
+        edge_begin.assign(n + 1, 0);
+        edge_word.clear();
+        edge_target.clear();
+        for (size_t i = 0; i < n; ++i) {
+            edge_begin[i] = static_cast<uint32_t>(edge_word.size());
+            if (i == 0) continue;  // root edges live in root_next
+            for (const auto& c : children[order[i]]) {
+                edge_word.push_back(c.first);
+                edge_target.push_back(new_id[c.second]);
+            }
+        }
+        edge_begin[n] = static_cast<uint32_t>(edge_word.size());
+        root_next.assign(vocab.size(), ROOT);
+        for (const auto& c : children[0]) root_next[c.first] = new_id[c.second];
+
+        // Failure links in BFS order; outputs are merged along the way so
+        // a single lookup per step reports every phrase ending there.
+        fail.assign(n, ROOT);
+        std::vector<std::vector<uint32_t>> outs(n);
+        for (size_t i = 0; i < n; ++i) outs[i] = own_out[order[i]];
+        for (size_t i = 1; i < n; ++i) {
+            for (const auto& c : children[order[i]]) {
+                uint32_t child = new_id[c.second];
+                uint32_t f = fail[i];
+                uint32_t next;
+                while ((next = goTo(f, c.first)) == UINT32_MAX) f = fail[f];
+                fail[child] = (next == child) ? ROOT : next;
+            }
+        }
+        // Root's children are at depth 1 and keep fail = ROOT. BFS order
+        // guarantees fail[s] < s, so fail's outputs are complete when s is visited.
+        out_begin.assign(n + 1, 0);
+        out_phrase.clear();
+        for (size_t i = 0; i < n; ++i) {
+            if (i > 0 && fail[i] != ROOT) {
+                outs[i].insert(outs[i].end(), outs[fail[i]].begin(), outs[fail[i]].end());
+            }
+            out_begin[i] = static_cast<uint32_t>(out_phrase.size());
+            out_phrase.insert(out_phrase.end(), outs[i].begin(), outs[i].end());
+        }
+        out_begin[n] = static_cast<uint32_t>(out_phrase.size());
+        pending.clear();
+    }
+
+    uint32_t wordId(const std::string& word) const {
+        auto it = vocab.find(normalize(word));
+        return it == vocab.end() ? UNKNOWN_WORD : it->second;
+    }
+
+    uint32_t step(uint32_t state, uint32_t word) const {
+        uint32_t next;
+        while ((next = goTo(state, word)) == UINT32_MAX) state = fail[state];
+        return next;
+    }
+
+    const uint32_t* outputsBegin(uint32_t state) const { return out_phrase.data() + out_begin[state]; }
+    const uint32_t* outputsEnd(uint32_t state) const { return out_phrase.data() + out_begin[state + 1]; }
+
+    size_t phraseCount() const { return phrases.size(); }
+    size_t stateCount() const { return fail.size(); }
+    const std::string& phrase(uint32_t id) const { return phrases[id]; }
+    uint32_t phraseLength(uint32_t id) const { return phrase_len[id]; }
+};
+
+class KeywordScanner {
+private:
+    const KeywordAutomaton& automaton;
+    std::vector<uint32_t> tokens;    // word ids consumed in this utterance
+    std::vector<uint32_t> states;    // states[i]: state after tokens[0..i)
+    std::unordered_set<uint64_t> reported;  // (end index, phrase id) already alerted
+    std::vector<VoskWord> words;     // scratch
+
+    static std::vector<VoskWord>& wordsFromText(const std::string& text, std::vector<VoskWord>& out) {
+        out.clear();
+        std::istringstream in(text);
+        VoskWord w;
+        w.start = w.end = -1.0;
+        while (in >> w.word) out.push_back(w);
+        return out;
+    }
+
+    void scan(const std::vector<VoskWord>& current, bool is_final, std::vector<KeywordAlert>& alerts) {
+        // Keep the unchanged prefix, rewind over anything Vosk revised
+        size_t keep = 0;
+        while (keep < tokens.size() && keep < current.size() &&
+               tokens[keep] == automaton.wordId(current[keep].word)) {
+            ++keep;
+        }
+        tokens.resize(keep);
+        states.resize(keep + 1);
+
+        uint32_t state = states.back();
+        for (size_t i = keep; i < current.size(); ++i) {
+            uint32_t id = automaton.wordId(current[i].word);
+            state = automaton.step(state, id);
+            tokens.push_back(id);
+            states.push_back(state);
+            for (const uint32_t* p = automaton.outputsBegin(state); p != automaton.outputsEnd(state); ++p) {
+                uint64_t key = (static_cast<uint64_t>(i) << 32) | *p;
+                if (!reported.insert(key).second) continue;
+                size_t first = i + 1 - automaton.phraseLength(*p);
+                alerts.push_back({*p, &automaton.phrase(*p),
+                                  current[first].start, current[i].end, is_final});
+            }
+        }
+    }
+
+public:
+    explicit KeywordScanner(const KeywordAutomaton& a) : automaton(a) { reset(); }
+
+    // Scans a partial result. Uses "partial_result" word times when
+    // vosk_recognizer_set_partial_words() is enabled, otherwise the text.
+    void scanPartial(const char* partial_json, std::vector<KeywordAlert>& alerts) {
+        if (!parseVoskWords(partial_json, "partial_result", words)) {
+            wordsFromText(parseVoskText(partial_json, "partial"), words);
+        }
+        scan(words, false, alerts);
+    }
+
+    // Scans a final result and starts a new utterance.
+    void scanFinal(const char* result_json, std::vector<KeywordAlert>& alerts) {
+        if (!parseVoskWords(result_json, "result", words)) {
+            wordsFromText(parseVoskText(result_json, "text"), words);
+        }
+        scan(words, true, alerts);
+        reset();
+    }
+
+    void reset() {
+        tokens.clear();
+        states.assign(1, 0);
+        reported.clear();
+    }
+};
+
+#endif // KEYWORD_ALERT_H
@@ -0,0 +1,145 @@
+// Spoken-language identification by a short parallel decode.
+//
+// Running a stream through every language's model is too expensive, but
+// doing so for the first few seconds is not. The identifier feeds the
+// stream's first LID_DECIDE_SECONDS of speech to one small recognizer per
+// candidate model and picks the model that explains the audio best: the
+// mean word confidence, with "[unk]" counting as zero. Speech in the wrong
+// language comes out as low-confidence words or [unk].
+//
+// A candidate model directory may contain LID_WORDS_FILE, one common word
+// or phrase per line; the candidate then decodes with that grammar instead
+// of the full graph, which is much cheaper and makes [unk] do the work.
+//
+// The audio fed during identification is kept, together with the points
+// where utterances ended, so the chosen model's recognizer can be given
+// the same audio afterwards and nothing is lost.
+
+#ifndef LANGUAGE_ID_H
+#define LANGUAGE_ID_H
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "vosk_api.h"
+#include "vosk_result.h"
+#include "grammar_builder.h"
+
+#define LID_DECIDE_SECONDS  (3.0)     // speech needed before deciding
+#define LID_WORDS_FILE      "lid_words.txt"
+
+struct LanguageScore {
+    std::string name;
+    unsigned long words = 0;      // including [unk]
+    unsigned long unknown = 0;
+    double conf_sum = 0.0;        // over known words
+    double decode_ms = 0.0;
+    bool grammar = false;
+
+    double score() const { return words ? conf_sum / words : 0.0; }
+};
+
+class LanguageIdentifier {
+private:
+    struct Candidate {
+        VoskRecognizer* recognizer = nullptr;
+        LanguageScore score;
+    };
+
+    std::vector<Candidate> candidates;
+    std::vector<short> buffered;
+    std::vector<size_t> boundaries;   // buffered sample counts at utterance ends
+    float sample_rate;
+    std::vector<VoskWord> words;      // scratch
+
+    void scoreResult(Candidate& c, const char* json) {
+        words.clear();
+        parseVoskWords(json, "result", words);
+        for (const VoskWord& w : words) {
+            c.score.words++;
+            if (w.word == "[unk]") c.score.unknown++;
+            else c.score.conf_sum += w.conf;
+        }
+    }
+
+    void freeRecognizers() {
+        for (Candidate& c : candidates) {
+            if (c.recognizer) vosk_recognizer_free(c.recognizer);
+            c.recognizer = nullptr;
+        }
+    }
+
+public:
+    explicit LanguageIdentifier(float rate) : sample_rate(rate) {}
+    ~LanguageIdentifier() { freeRecognizers(); }
+
+    LanguageIdentifier(const LanguageIdentifier&) = delete;
+    LanguageIdentifier& operator=(const LanguageIdentifier&) = delete;
+
+    // Adds a candidate language. Uses model_dir/LID_WORDS_FILE as grammar
+    // if present. Returns false if no recognizer could be created.
+    bool addCandidate(const std::string& name, VoskModel* model, const std::string& model_dir) {
+        Candidate c;
+        c.score.name = name;
+        std::ifstream file(model_dir + "/" + LID_WORDS_FILE);
+        if (file.is_open()) {
+            GrammarBuilder builder(model);
+            std::string line;
+            while (std::getline(file, line)) builder.addPhrase(line);
+            if (builder.phraseCount() > 0) {
+                c.recognizer = vosk_recognizer_new_grm(model, sample_rate, builder.json().c_str());
+                c.score.grammar = c.recognizer != nullptr;
+            }
+        }
+        if (!c.recognizer) c.recognizer = vosk_recognizer_new(model, sample_rate);
+        if (!c.recognizer) return false;
+        vosk_recognizer_set_words(c.recognizer, 1);
+        candidates.push_back(c);
+        return true;
+    }
+
+    // Feeds a block of speech to every candidate and keeps it for replay
+    void accept(const short* audio, unsigned long frames) {
+        buffered.insert(buffered.end(), audio, audio + frames);
+        for (Candidate& c : candidates) {
+            auto start = std::chrono::steady_clock::now();
+            if (vosk_recognizer_accept_waveform_s(c.recognizer, audio, (int)frames) > 0) {
+                scoreResult(c, vosk_recognizer_result(c.recognizer));
+            }
+            c.score.decode_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    // The utterance fed so far has ended (gate-driven endpoint)
+    void markBoundary() {
+        if (!buffered.empty() && (boundaries.empty() || boundaries.back() != buffered.size())) {
+            boundaries.push_back(buffered.size());
+        }
+    }
+
+    bool ready() const { return buffered.size() >= LID_DECIDE_SECONDS * sample_rate; }
+
+    // Flushes every candidate, frees their recognizers and returns the index
+    // of the best one (0 if none scored)
+    size_t decide() {
+        for (Candidate& c : candidates) {
+            if (c.recognizer) scoreResult(c, vosk_recognizer_final_result(c.recognizer));
+        }
+        freeRecognizers();
+        size_t best = 0;
+        for (size_t i = 1; i < candidates.size(); ++i) {
+            if (candidates[i].score.score() > candidates[best].score.score()) best = i;
+        }
+        return best;
+    }
+
+    size_t candidateCount() const { return candidates.size(); }
+    const LanguageScore& score(size_t i) const { return candidates[i].score; }
+    const std::vector<short>& bufferedAudio() const { return buffered; }
+    const std::vector<size_t>& utteranceEnds() const { return boundaries; }
+    double bufferedSeconds() const { return buffered.size() / (double)sample_rate; }
+};
+
+#endif // LANGUAGE_ID_H
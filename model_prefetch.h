@@ -0,0 +1,168 @@
+// Pulls a model directory into the page cache before vosk_model_new()
+// reads it.
+//
+// vosk_model_new() reads final.mdl, HCLG.fst, the i-vector extractor and
+// the rest one file at a time, with one outstanding request. On a cold
+// cache from a network disk that is latency-bound. The prefetcher lists
+// every file under the model directory and gets the data moving with many
+// requests in flight, so the loader finds most of it cached:
+//
+//   FADVISE    posix_fadvise(WILLNEED) per file; the kernel reads ahead
+//              asynchronously (cheap, but some filesystems ignore it)
+//   READAHEAD  readahead(2) per file, spread over the threads
+//   THREADS    plain reads in 4 MB chunks by a pool of threads; works on
+//              any filesystem, and large files are read by several threads
+//
+// start() returns immediately, so the model load can run alongside the
+// prefetch; wait() joins the threads and fills in the report.
+
+#ifndef MODEL_PREFETCH_H
+#define MODEL_PREFETCH_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define MODEL_PREFETCH_CHUNK_BYTES  (4 * 1024 * 1024)
+
+enum class PrefetchMode { FADVISE, READAHEAD, THREADS };
+
+inline const char* prefetchModeName(PrefetchMode mode) {
+    switch (mode) {
+        case PrefetchMode::FADVISE: return "fadvise";
+        case PrefetchMode::READAHEAD: return "readahead";
+        case PrefetchMode::THREADS: return "threads";
+    }
+    return "?";
+}
+
+struct PrefetchReport {
+    size_t files = 0;
+    uint64_t bytes = 0;
+    double scan_ms = 0.0;
+    double prefetch_ms = 0.0;   // start() to the last thread finishing
+};
+
+struct ModelFile {
+    std::string path;
+    uint64_t size = 0;
+};
+
+// Lists regular files under `dir`, recursively, largest first
+inline bool listModelFiles(const std::string& dir, std::vector<ModelFile>& files) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) return false;
+    while (dirent* entry = readdir(d)) {
+        if (entry->d_name[0] == '.') continue;
+        std::string path = dir + "/" + entry->d_name;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            listModelFiles(path, files);
+        } else if (S_ISREG(st.st_mode)) {
+            files.push_back({path, static_cast<uint64_t>(st.st_size)});
+        }
+    }
+    closedir(d);
+    return true;
+}
+
+class ModelPrefetcher {
+private:
+    struct Task {
+        size_t file;
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    std::vector<ModelFile> files;
+    std::vector<Task> tasks;
+    std::atomic<size_t> next_task{0};
+    std::vector<std::thread> threads;
+    PrefetchMode mode = PrefetchMode::THREADS;
+    std::chrono::steady_clock::time_point started;
+    PrefetchReport report;
+
+    void worker() {
+        std::vector<char> buffer(mode == PrefetchMode::THREADS ? MODEL_PREFETCH_CHUNK_BYTES : 0);
+        size_t i;
+        while ((i = next_task.fetch_add(1)) < tasks.size()) {
+            const Task& task = tasks[i];
+            int fd = open(files[task.file].path.c_str(), O_RDONLY);
+            if (fd < 0) continue;
+            switch (mode) {
+                case PrefetchMode::FADVISE:
+                    posix_fadvise(fd, task.offset, task.length, POSIX_FADV_WILLNEED);
+                    break;
+                case PrefetchMode::READAHEAD:
+                    readahead(fd, task.offset, task.length);
+                    break;
+                case PrefetchMode::THREADS: {
+                    uint64_t done = 0;
+                    while (done < task.length) {
+                        ssize_t n = pread(fd, buffer.data(), std::min<uint64_t>(buffer.size(), task.length - done),
+                                          task.offset + done);
+                        if (n <= 0) break;
+                        done += n;
+                    }
+                    break;
+                }
+            }
+            close(fd);
+        }
+    }
+
+public:
+    ~ModelPrefetcher() { wait(); }
+
+    // Lists the model files and starts `thread_count` prefetch threads
+    bool start(const std::string& model_dir, PrefetchMode prefetch_mode, int thread_count) {
+        wait();
+        files.clear();
+        tasks.clear();
+        report = PrefetchReport();
+        mode = prefetch_mode;
+
+        auto scan_start = std::chrono::steady_clock::now();
+        if (!listModelFiles(model_dir, files)) return false;
+        std::sort(files.begin(), files.end(), [](const ModelFile& a, const ModelFile& b) { return a.size > b.size; });
+        for (size_t f = 0; f < files.size(); ++f) {
+            report.bytes += files[f].size;
+            // fadvise covers a whole file in one call; the others split large files
+            uint64_t chunk = (mode == PrefetchMode::FADVISE) ? files[f].size : MODEL_PREFETCH_CHUNK_BYTES;
+            for (uint64_t off = 0; off < files[f].size || off == 0; off += chunk) {
+                tasks.push_back({f, off, std::min<uint64_t>(chunk, files[f].size - off)});
+                if (chunk == 0) break;
+            }
+        }
+        report.files = files.size();
+        started = std::chrono::steady_clock::now();
+        report.scan_ms = std::chrono::duration<double, std::milli>(started - scan_start).count();
+
+        next_task = 0;
+        int n = std::max(1, std::min<int>(thread_count, (int)tasks.size()));
+        for (int t = 0; t < n; ++t) threads.emplace_back(&ModelPrefetcher::worker, this);
+        return true;
+    }
+
+    // Joins the prefetch threads
+    void wait() {
+        if (threads.empty()) return;
+        for (std::thread& t : threads) t.join();
+        threads.clear();
+        report.prefetch_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    const std::vector<ModelFile>& getFiles() const { return files; }
+    const PrefetchReport& getReport() const { return report; }
+};
+
+#endif // MODEL_PREFETCH_H
@@ -0,0 +1,235 @@
+// Registry of named models, loaded on first use and evicted when idle.
+//
+// Each entry maps a name ("en", "de", "en-medical") to a model directory.
+// acquire() loads the model the first time it is asked for and counts a
+// reference for every caller holding it; release() drops the reference.
+// Whenever the process RSS is above the budget, idle models (no
+// references) are freed, least recently used first, until it fits again or
+// nothing idle is left. Models in use are never evicted, so the budget is
+// a target, not a hard cap.
+//
+// Loads happen outside the registry lock, so a slow load does not hold up
+// other models; callers asking for a model that is still loading wait for
+// it. Every load and eviction is reported to the event callback.
+
+#ifndef MODEL_REGISTRY_H
+#define MODEL_REGISTRY_H
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <malloc.h>
+#include <unistd.h>
+
+#include "vosk_api.h"
+#include "model_prefetch.h"
+
+// Resident set size of this process, from /proc/self/statm
+inline size_t currentRssBytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages_total = 0, pages_resident = 0;
+    statm >> pages_total >> pages_resident;
+    return pages_resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+struct ModelEvent {
+    enum Type { LOADED, LOAD_FAILED, EVICTED };
+    Type type;
+    std::string name;
+    double ms;              // time to load or free
+    size_t rss_before;
+    size_t rss_after;
+};
+
+class ModelRegistry {
+private:
+    enum class State { UNLOADED, LOADING, LOADED };
+
+    struct Entry {
+        std::string path;
+        State state = State::UNLOADED;
+        VoskModel* model = nullptr;
+        unsigned long refs = 0;
+        std::chrono::steady_clock::time_point last_used;
+        unsigned long loads = 0;
+    };
+
+    std::map<std::string, Entry> entries;
+    std::mutex mutex;
+    std::condition_variable loaded_cv;
+    size_t rss_budget;
+    int prefetch_threads;
+    std::function<void(const ModelEvent&)> on_event;
+    std::vector<ModelEvent> events;
+
+    void emit(const ModelEvent& event) {
+        events.push_back(event);
+        if (on_event) on_event(event);
+    }
+
+    // Frees idle models, least recently used first, while over budget.
+    // Called with the lock held.
+    void enforceBudget() {
+        while (rss_budget > 0 && currentRssBytes() > rss_budget) {
+            Entry* victim = nullptr;
+            const std::string* victim_name = nullptr;
+            for (auto& kv : entries) {
+                Entry& e = kv.second;
+                if (e.state != State::LOADED || e.refs > 0) continue;
+                if (!victim || e.last_used < victim->last_used) {
+                    victim = &e;
+                    victim_name = &kv.first;
+                }
+            }
+            if (!victim) return;   // everything resident is in use
+
+            size_t rss_before = currentRssBytes();
+            auto start = std::chrono::steady_clock::now();
+            vosk_model_free(victim->model);
+            malloc_trim(0);   // hand freed arenas back so RSS actually drops
+            victim->model = nullptr;
+            victim->state = State::UNLOADED;
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            emit({ModelEvent::EVICTED, *victim_name, ms, rss_before, currentRssBytes()});
+        }
+    }
+
+public:
+    // rss_budget_bytes == 0 never evicts
+    explicit ModelRegistry(size_t rss_budget_bytes, int prefetch_thread_count = 0)
+        : rss_budget(rss_budget_bytes), prefetch_threads(prefetch_thread_count) {}
+
+    ~ModelRegistry() {
+        for (auto& kv : entries) {
+            if (kv.second.model) vosk_model_free(kv.second.model);
+        }
+    }
+
+    ModelRegistry(const ModelRegistry&) = delete;
+    ModelRegistry& operator=(const ModelRegistry&) = delete;
+
+    void setEventCallback(std::function<void(const ModelEvent&)> callback) { on_event = callback; }
+
+    void add(const std::string& name, const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries[name].path = path;
+    }
+
+    // Reads "name path" lines; blank lines and lines starting with '#' are
+    // skipped. Returns the number of models added, or -1 if the file cannot
+    // be opened.
+    int loadList(const std::string& list_path) {
+        std::ifstream file(list_path);
+        if (!file.is_open()) return -1;
+        int added = 0;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::stringstream ss(line);
+            std::string name, path;
+            if (!(ss >> name >> path) || name[0] == '#') continue;
+            add(name, path);
+            added++;
+        }
+        return added;
+    }
+
+    bool has(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.count(name) > 0;
+    }
+
+    std::string pathOf(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(name);
+        return it == entries.end() ? std::string() : it->second.path;
+    }
+
+    // The named model, loading it if needed, or nullptr if it is unknown or
+    // fails to load. Every non-null result must be released.
+    VoskModel* acquire(const std::string& name) {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = entries.find(name);
+        if (it == entries.end()) return nullptr;
+        Entry& entry = it->second;
+        loaded_cv.wait(lock, [&entry]() { return entry.state != State::LOADING; });
+        if (entry.state == State::LOADED) {
+            entry.refs++;
+            entry.last_used = std::chrono::steady_clock::now();
+            return entry.model;
+        }
+
+        entry.state = State::LOADING;
+        std::string path = entry.path;
+        lock.unlock();
+        size_t rss_before = currentRssBytes();
+        auto start = std::chrono::steady_clock::now();
+        ModelPrefetcher prefetcher;
+        if (prefetch_threads > 0) prefetcher.start(path, PrefetchMode::THREADS, prefetch_threads);
+        VoskModel* model = vosk_model_new(path.c_str());
+        prefetcher.wait();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        lock.lock();
+
+        entry.model = model;
+        entry.state = model ? State::LOADED : State::UNLOADED;
+        loaded_cv.notify_all();
+        emit({model ? ModelEvent::LOADED : ModelEvent::LOAD_FAILED, name, ms, rss_before, currentRssBytes()});
+        if (!model) return nullptr;
+        entry.refs++;
+        entry.loads++;
+        entry.last_used = std::chrono::steady_clock::now();
+        enforceBudget();
+        return model;
+    }
+
+    void release(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(name);
+        if (it == entries.end() || it->second.refs == 0) return;
+        it->second.refs--;
+        it->second.last_used = std::chrono::steady_clock::now();
+        enforceBudget();
+    }
+
+    size_t loadedCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t n = 0;
+        for (auto& kv : entries) n += kv.second.state == State::LOADED;
+        return n;
+    }
+
+    // Loads, failures and evictions so far, with total load time
+    void printSummary(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        unsigned long loads = 0, failures = 0, evictions = 0;
+        double load_ms = 0.0;
+        for (const ModelEvent& e : events) {
+            if (e.type == ModelEvent::LOADED) { loads++; load_ms += e.ms; }
+            else if (e.type == ModelEvent::LOAD_FAILED) failures++;
+            else evictions++;
+        }
+        out << "Models: " << entries.size() << " registered, " << loads << " loads (" << (long)load_ms
+            << " ms total), " << failures << " failed, " << evictions << " evictions; RSS "
+            << currentRssBytes() / (1024 * 1024) << " MB";
+        if (rss_budget > 0) out << " of " << rss_budget / (1024 * 1024) << " MB budget";
+        out << std::endl;
+    }
+};
+
+inline const char* modelEventName(ModelEvent::Type type) {
+    switch (type) {
+        case ModelEvent::LOADED: return "loaded";
+        case ModelEvent::LOAD_FAILED: return "FAILED to load";
+        case ModelEvent::EVICTED: return "evicted";
+    }
+    return "?";
+}
+
+#endif // MODEL_REGISTRY_H
@@ -0,0 +1,123 @@
+// NUMA topology from sysfs, and thread/memory placement on a node.
+//
+// Linux allocates a page on the node of the CPU that first touches it, so
+// anything built by a thread pinned to a node - a VoskModel, a recognizer -
+// ends up in that node's memory. preferNodeMemory() makes this explicit for
+// the calling thread (MPOL_PREFERRED), so allocations still land on the
+// node if the scheduler briefly runs it elsewhere. No libnuma needed.
+//
+// Machines without /sys/devices/system/node are treated as one node with
+// all online CPUs.
+
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+struct NumaNode {
+    int id = 0;
+    std::vector<int> cpus;
+};
+
+// Parses a sysfs CPU list such as "0-3,8-11"
+inline std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") continue;
+        size_t dash = range.find('-');
+        int first = atoi(range.c_str());
+        int last = (dash == std::string::npos) ? first : atoi(range.c_str() + dash + 1);
+        for (int c = first; c <= last; ++c) cpus.push_back(c);
+    }
+    return cpus;
+}
+
+class NumaTopology {
+private:
+    std::vector<NumaNode> nodes;
+
+public:
+    // Reads /sys/devices/system/node. Returns the number of nodes found (at
+    // least 1).
+    size_t detect() {
+        nodes.clear();
+        DIR* dir = opendir("/sys/devices/system/node");
+        if (dir) {
+            while (dirent* entry = readdir(dir)) {
+                if (strncmp(entry->d_name, "node", 4) != 0 || !isdigit(entry->d_name[4])) continue;
+                NumaNode node;
+                node.id = atoi(entry->d_name + 4);
+                std::ifstream file(std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist");
+                std::string list;
+                std::getline(file, list);
+                node.cpus = parseCpuList(list);
+                if (!node.cpus.empty()) nodes.push_back(node);   // memory-only nodes run no workers
+            }
+            closedir(dir);
+        }
+        if (nodes.empty()) {
+            NumaNode node;
+            long n = sysconf(_SC_NPROCESSORS_ONLN);
+            for (int c = 0; c < n; ++c) node.cpus.push_back(c);
+            nodes.push_back(node);
+        }
+        std::sort(nodes.begin(), nodes.end(), [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+        return nodes.size();
+    }
+
+    size_t nodeCount() const { return nodes.size(); }
+    const NumaNode& node(size_t index) const { return nodes[index]; }
+
+    // Index (not id) of the node that owns `cpu`, or -1
+    int nodeIndexOfCpu(int cpu) const {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (std::find(nodes[i].cpus.begin(), nodes[i].cpus.end(), cpu) != nodes[i].cpus.end()) return (int)i;
+        }
+        return -1;
+    }
+};
+
+// Restricts the calling thread to the node's CPUs
+inline bool pinThreadToNode(const NumaNode& node) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : node.cpus) CPU_SET(cpu, &set);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+        std::cerr << "WARNING: Cannot pin thread to NUMA node " << node.id << ": " << strerror(err) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Prefers the node's memory for the calling thread's new allocations
+inline bool preferNodeMemory(const NumaNode& node) {
+#ifdef SYS_set_mempolicy
+    const int MPOL_PREFERRED_MODE = 1;   // MPOL_PREFERRED in <linux/mempolicy.h>
+    unsigned long mask[16] = {};
+    if (node.id < 0 || node.id >= (int)(sizeof(mask) * 8)) return false;
+    mask[node.id / (8 * sizeof(unsigned long))] |= 1ul << (node.id % (8 * sizeof(unsigned long)));
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED_MODE, mask, sizeof(mask) * 8 + 1) != 0) {
+        return false;   // e.g. kernel without NUMA support; first touch still applies
+    }
+    return true;
+#else
+    (void)node;
+    return false;
+#endif
+}
+
+#endif // NUMA_TOPOLOGY_H
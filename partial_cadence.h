@@ -0,0 +1,71 @@
+// Controls how often a stream asks Vosk for a partial result.
+//
+// vosk_recognizer_partial_result() walks the decoder's best path and
+// formats a JSON string on every call. Doing that after every 32 ms block
+// costs a noticeable share of the decode time, while most consumers only
+// need a few updates per second, or none at all.
+//
+//   EVERY_BLOCK  poll after every accept_waveform call (the old behaviour)
+//   TIME         poll once per interval of fed audio and pass every partial on
+//   CHANGE       poll once per interval, pass a partial on only if its text changed
+//   DISABLED     never poll; consumers only get final results
+
+#ifndef PARTIAL_CADENCE_H
+#define PARTIAL_CADENCE_H
+
+#include <string>
+
+#include "vosk_result.h"
+
+enum class PartialMode { EVERY_BLOCK, TIME, CHANGE, DISABLED };
+
+inline const char* partialModeName(PartialMode mode) {
+    switch (mode) {
+        case PartialMode::EVERY_BLOCK: return "every-block";
+        case PartialMode::TIME: return "time";
+        case PartialMode::CHANGE: return "change";
+        case PartialMode::DISABLED: return "disabled";
+    }
+    return "?";
+}
+
+class PartialCadence {
+private:
+    PartialMode mode;
+    unsigned long interval_frames;
+    unsigned long frames_since_poll = 0;
+    std::string last_text;
+
+public:
+    PartialCadence(PartialMode m, unsigned long interval_ms, int sample_rate)
+        : mode(m), interval_frames(interval_ms * sample_rate / 1000) {}
+
+    // Call after feeding `frames` to the recognizer without a final result.
+    // Returns true if vosk_recognizer_partial_result() should be called now.
+    bool onAudio(unsigned long frames) {
+        if (mode == PartialMode::DISABLED) return false;
+        frames_since_poll += frames;
+        if (mode != PartialMode::EVERY_BLOCK && frames_since_poll < interval_frames) return false;
+        frames_since_poll = 0;
+        return true;
+    }
+
+    // Returns true if a polled partial should be passed on to consumers.
+    bool accept(const char* partial_json) {
+        std::string text = parseVoskText(partial_json, "partial");
+        if (text.empty()) return false;
+        if (mode == PartialMode::CHANGE && text == last_text) return false;
+        last_text.swap(text);
+        return true;
+    }
+
+    // Call after a final result; the next utterance starts from scratch.
+    void onFinal() {
+        frames_since_poll = 0;
+        last_text.clear();
+    }
+
+    PartialMode getMode() const { return mode; }
+};
+
+#endif // PARTIAL_CADENCE_H
@@ -0,0 +1,220 @@
+// Compile-time composable preprocessing.
+//
+// The live programs differ mostly in which preprocessing stages they run.
+// Pipeline<Stages...> strings stage policies together at compile time: each
+// stage is a plain class with an inline process() member, held by value in
+// a tuple, so a pipeline compiles to one function with every stage inlined
+// and no virtual call per block or per sample.
+//
+// Stage interface:
+//     explicit Stage(const StreamDspConfig& config);
+//     void process(short* audio, unsigned long& frames, BlockResult& result);
+//
+// Every stage sees every block. `result` starts as SPEECH; a stage that
+// gates the block sets it to SILENCE, and stages that transform audio
+// leave such blocks alone. A resampler may shorten `frames`.
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "audio_dsp.h"
+#include "endpointer.h"
+#include "stream_dsp.h"
+
+// Noise gate: blocks whose RMS level is below the threshold are silence
+class GateStage {
+private:
+    double threshold;
+
+public:
+    explicit GateStage(const StreamDspConfig& config) : threshold(config.gate_threshold) {}
+
+    void process(short* audio, unsigned long& frames, BlockResult& result) {
+        if (result == BlockResult::SPEECH && !isAudioAboveNoiseGate(audio, frames, threshold)) {
+            result = BlockResult::SILENCE;
+        }
+    }
+};
+
+// Gate-driven endpointer: turns the silence that ends an utterance into
+// END_OF_SPEECH. Place it after the gate.
+class VadStage {
+private:
+    Endpointer endpointer;
+
+public:
+    explicit VadStage(const StreamDspConfig& config)
+        : endpointer(config.silence_ms, config.sample_rate) {}
+
+    void process(short* audio, unsigned long& frames, BlockResult& result) {
+        (void)audio;
+        if (result == BlockResult::SPEECH) {
+            endpointer.onSpeech();
+        } else if (endpointer.onSilence(frames)) {
+            result = BlockResult::END_OF_SPEECH;
+        }
+    }
+
+    // The recognizer produced a final on its own
+    void onFinal() { endpointer.onFinal(); }
+};
+
+// DC-blocking high-pass filter
+class HighPassStage {
+private:
+    float prev_input = 0.0f;
+    float prev_output = 0.0f;
+
+public:
+    explicit HighPassStage(const StreamDspConfig&) {}
+
+    void process(short* audio, unsigned long& frames, BlockResult& result) {
+        if (result == BlockResult::SPEECH) applyHighPassFilter(audio, frames, prev_input, prev_output);
+    }
+};
+
+// Automatic gain control
+class AgcStage {
+private:
+    float gain = 1.0f;
+    float target_level;
+    float adjustment_rate;
+
+public:
+    explicit AgcStage(const StreamDspConfig& config)
+        : target_level(config.agc_target_level), adjustment_rate(config.agc_adjustment_rate) {}
+
+    void process(short* audio, unsigned long& frames, BlockResult& result) {
+        if (result == BlockResult::SPEECH) applyAGC(audio, frames, gain, target_level, adjustment_rate);
+    }
+
+    float getGain() const { return gain; }
+};
+
+// Smoothing ring of recent processed audio (see smoothBlock())
+class SmootherStage {
+private:
+    std::vector<short> ring;
+    uint32_t head = 0;
+
+public:
+    explicit SmootherStage(const StreamDspConfig&) : ring(STREAM_DSP_SMOOTHING_FRAMES) {}
+
+    void process(short* audio, unsigned long& frames, BlockResult& result) {
+        if (result != BlockResult::SPEECH || frames > ring.size()) return;
+        uint32_t first = std::min<uint32_t>(frames, ring.size() - head);
+        std::copy(audio, audio + first, ring.begin() + head);
+        std::copy(audio + first, audio + frames, ring.begin());
+        head = (head + frames) % ring.size();
+    }
+};
+
+// Windowed-sinc (Blackman) low-pass FIR: `count` taps, cutoff in cycles
+// per input sample, unity gain at DC
+inline std::vector<float> designLowPass(size_t count, double cutoff) {
+    const double pi = 3.141592653589793;
+    std::vector<float> taps(count);
+    double sum = 0.0;
+    double middle = (count - 1) / 2.0;
+    for (size_t k = 0; k < count; ++k) {
+        double x = k - middle;
+        double sinc = (x == 0.0) ? 2.0 * cutoff : std::sin(2.0 * pi * cutoff * x) / (pi * x);
+        double window = 0.42 - 0.5 * std::cos(2.0 * pi * k / (count - 1)) + 0.08 * std::cos(4.0 * pi * k / (count - 1));
+        taps[k] = static_cast<float>(sinc * window);
+        sum += taps[k];
+    }
+    for (float& t : taps) t = static_cast<float>(t / sum);
+    return taps;
+}
+
+// Downsampler from INPUT_RATE to config.sample_rate, in place. An
+// anti-alias FIR low-pass (cutoff at 0.42 of the output rate, e.g. 6.7 kHz
+// for 16 kHz) is evaluated at the input samples each output needs, and
+// the output is interpolated linearly between them, so content above the
+// new Nyquist frequency does not fold into the recognizer's band. The
+// filter delays the audio by half its length (1 ms at 48 kHz). Runs on
+// every block, gated or not, so it belongs first: the other stages then
+// work at the recognizer's rate.
+template <int INPUT_RATE>
+class ResampleStage {
+private:
+    double step;             // input samples per output sample
+    double position = 0.0;   // next output position, relative to this block
+    std::vector<float> taps;
+    std::vector<short> input;   // the previous taps.size() samples, then this block
+
+    // Low-passed input sample i of this block; i >= -1
+    float filtered(long i) const {
+        const short* x = input.data() + taps.size() + i;
+        float sum = 0.0f;
+        for (size_t k = 0; k < taps.size(); ++k) sum += taps[k] * x[-static_cast<long>(k)];
+        return sum;
+    }
+
+public:
+    explicit ResampleStage(const StreamDspConfig& config)
+        : step(static_cast<double>(INPUT_RATE) / config.sample_rate) {
+        if (step <= 1.0) return;
+        taps = designLowPass(32 * static_cast<size_t>(std::ceil(step)) + 1, 0.42 / step);
+        input.assign(taps.size(), 0);
+    }
+
+    void process(short* audio, unsigned long& frames, BlockResult& result) {
+        (void)result;
+        if (step <= 1.0 || frames == 0) return;   // only downsampling, in place
+        size_t history = taps.size();
+        input.resize(history + frames);
+        std::copy(audio, audio + frames, input.begin() + history);
+        unsigned long out = 0;
+        while (position < frames - 1) {
+            long i = static_cast<long>(position + 1.0) - 1;   // floor, position >= -1
+            double frac = position - i;
+            float a = filtered(i);
+            float v = (frac > 0.0) ? a + (filtered(i + 1) - a) * static_cast<float>(frac) : a;
+            audio[out++] = static_cast<short>(std::max(-32768.0f, std::min(32767.0f, v)));
+            position += step;
+        }
+        std::copy(input.end() - history, input.end(), input.begin());
+        input.resize(history);
+        position -= frames;
+        frames = out;
+    }
+};
+
+template <class... Stages>
+class Pipeline {
+private:
+    std::tuple<Stages...> stages;
+
+public:
+    explicit Pipeline(const StreamDspConfig& config = StreamDspConfig())
+        : stages(Stages(config)...) {}
+
+    // Runs every stage on one block, in place. `frames` is updated if a
+    // stage changes the block length.
+    BlockResult process(short* audio, unsigned long& frames) {
+        BlockResult result = BlockResult::SPEECH;
+        std::apply([&](Stages&... stage) { (stage.process(audio, frames, result), ...); }, stages);
+        return result;
+    }
+
+    template <class Stage>
+    Stage& stage() { return std::get<Stage>(stages); }
+};
+
+// Pipelines of the live programs
+// main.cpp, voice_basic.cpp, vb_w_micchoice.cpp: raw audio straight to Vosk
+typedef Pipeline<> BasicPipeline;
+// voice_w_cbuff.cpp: same chain and order as processBlock()
+typedef Pipeline<GateStage, VadStage, HighPassStage, AgcStage, SmootherStage> BufferedPipeline;
+// voice_w_cbuff.cpp chain for a 48 kHz device
+typedef Pipeline<ResampleStage<48000>, GateStage, VadStage, HighPassStage, AgcStage, SmootherStage>
+    Buffered48kPipeline;
+
+#endif // PIPELINE_H
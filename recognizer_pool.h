@@ -0,0 +1,158 @@
+// Pool of ready-to-use recognizers for one model, warmed up before use.
+//
+// The first utterance a fresh recognizer decodes is much slower than the
+// ones after it: the decoder allocates its lattices, feature pipeline and
+// caches lazily, and the model's weights are paged in on first touch. The
+// pool runs a few seconds of synthetic speech-like audio through every
+// recognizer it creates and then resets it, so that cost is paid before
+// traffic arrives rather than by the first caller.
+//
+// acquire() hands out a warm recognizer (creating and warming one if the
+// pool is empty); release() resets it and puts it back. Thread-safe.
+
+#ifndef RECOGNIZER_POOL_H
+#define RECOGNIZER_POOL_H
+
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+#include "vosk_api.h"
+
+#define WARMUP_BLOCK_FRAMES     (512)
+
+// Speech-like test signal: a voiced source (harmonics of a gliding pitch,
+// shaped by two slowly moving formants) switched on and off at syllable
+// rate, over a little noise. Enough to drive the decoder through feature
+// extraction, the acoustic model and the graph search; the words it yields
+// do not matter.
+inline std::vector<short> generateWarmupAudio(double seconds, int sample_rate) {
+    std::vector<short> audio(static_cast<size_t>(seconds * sample_rate));
+    const double two_pi = 6.283185307179586;
+    double phase = 0.0;
+    unsigned int noise = 12345;
+    for (size_t i = 0; i < audio.size(); ++i) {
+        double t = (double)i / sample_rate;
+        double pitch = 120.0 + 30.0 * std::sin(two_pi * 0.7 * t);
+        double formant1 = 500.0 + 300.0 * std::sin(two_pi * 2.1 * t);
+        double formant2 = 1500.0 + 700.0 * std::sin(two_pi * 1.3 * t + 1.0);
+        phase += two_pi * pitch / sample_rate;
+        double voiced = 0.0;
+        for (int h = 1; h * pitch < 4000.0; ++h) {
+            double f = h * pitch;
+            double weight = 1.0 / (1.0 + std::pow((f - formant1) / 150.0, 2))
+                          + 0.5 / (1.0 + std::pow((f - formant2) / 200.0, 2));
+            voiced += weight * std::sin(h * phase);
+        }
+        double syllable = std::sin(two_pi * 4.0 * t);
+        double envelope = syllable > 0.0 ? syllable : 0.0;
+        if (std::fmod(t, 3.0) > 2.4) envelope = 0.0;   // a pause every 3 s, so endpointing runs too
+        noise = noise * 1103515245u + 12345u;
+        double hiss = ((noise >> 16) & 0x7fff) / 32768.0 - 0.5;
+        audio[i] = static_cast<short>(3000.0 * envelope * voiced + 200.0 * hiss);
+    }
+    return audio;
+}
+
+// Decodes `audio` (partials, finals and a final flush) and resets the
+// recognizer. Returns the time taken in milliseconds.
+inline double warmUpRecognizer(VoskRecognizer* recognizer, const std::vector<short>& audio) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t pos = 0; pos + WARMUP_BLOCK_FRAMES <= audio.size(); pos += WARMUP_BLOCK_FRAMES) {
+        if (vosk_recognizer_accept_waveform_s(recognizer, audio.data() + pos, WARMUP_BLOCK_FRAMES) > 0) {
+            vosk_recognizer_result(recognizer);
+        } else {
+            vosk_recognizer_partial_result(recognizer);
+        }
+    }
+    vosk_recognizer_final_result(recognizer);
+    vosk_recognizer_reset(recognizer);
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+class RecognizerPool {
+private:
+    VoskModel* model;
+    float sample_rate;
+    std::vector<short> warmup_audio;
+    std::vector<VoskRecognizer*> idle;
+    std::mutex mutex;
+    unsigned long created = 0;
+    double warmup_ms = 0.0;
+
+    VoskRecognizer* create() {
+        VoskRecognizer* recognizer = vosk_recognizer_new(model, sample_rate);
+        if (!recognizer) return nullptr;
+        double ms = warmup_audio.empty() ? 0.0 : warmUpRecognizer(recognizer, warmup_audio);
+        std::lock_guard<std::mutex> lock(mutex);
+        created++;
+        warmup_ms += ms;
+        return recognizer;
+    }
+
+public:
+    // warmup_seconds == 0 hands out cold recognizers
+    RecognizerPool(VoskModel* m, float rate, double warmup_seconds)
+        : model(m), sample_rate(rate), warmup_audio(generateWarmupAudio(warmup_seconds, (int)rate)) {}
+
+    ~RecognizerPool() {
+        for (VoskRecognizer* recognizer : idle) vosk_recognizer_free(recognizer);
+    }
+
+    RecognizerPool(const RecognizerPool&) = delete;
+    RecognizerPool& operator=(const RecognizerPool&) = delete;
+
+    // Creates and warms recognizers until `count` are idle. Returns false if
+    // the model refused to create one.
+    bool fill(size_t count) {
+        while (idleCount() < count) {
+            VoskRecognizer* recognizer = create();
+            if (!recognizer) return false;
+            std::lock_guard<std::mutex> lock(mutex);
+            idle.push_back(recognizer);
+        }
+        return true;
+    }
+
+    // A warm recognizer, or nullptr if one could not be created
+    VoskRecognizer* acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!idle.empty()) {
+                VoskRecognizer* recognizer = idle.back();
+                idle.pop_back();
+                return recognizer;
+            }
+        }
+        return create();
+    }
+
+    // Returns a recognizer to the pool, reset for the next stream
+    void release(VoskRecognizer* recognizer) {
+        if (!recognizer) return;
+        vosk_recognizer_reset(recognizer);
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(recognizer);
+    }
+
+    size_t idleCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return idle.size();
+    }
+
+    unsigned long createdCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return created;
+    }
+
+    // Total time spent warming recognizers up
+    double warmupMs() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return warmup_ms;
+    }
+
+    double warmupSeconds() const { return warmup_audio.size() / (double)sample_rate; }
+};
+
+#endif // RECOGNIZER_POOL_H
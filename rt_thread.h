@@ -0,0 +1,97 @@
+// Real-time scheduling helpers for the capture and decoder threads.
+//
+// Under host load an ordinary thread can be preempted long enough for the
+// audio device to overflow, and the first decode after an idle period can
+// stall on page faults through the model. These helpers move the calling
+// thread to SCHED_FIFO or SCHED_RR, pin it to one CPU, and lock and
+// prefault the process memory. Each reports failures (usually missing
+// CAP_SYS_NICE / CAP_IPC_LOCK or a low RLIMIT_RTPRIO / RLIMIT_MEMLOCK) on
+// std::cerr and returns false; the program keeps running without it.
+
+#ifndef RT_THREAD_H
+#define RT_THREAD_H
+
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+struct ThreadRtConfig {
+    int policy = SCHED_OTHER;   // SCHED_OTHER leaves scheduling as it is
+    int priority = 0;           // 1..99 for SCHED_FIFO / SCHED_RR
+    int cpu = -1;               // -1: no pinning
+};
+
+inline const char* schedPolicyName(int policy) {
+    switch (policy) {
+        case SCHED_OTHER: return "SCHED_OTHER";
+        case SCHED_FIFO: return "SCHED_FIFO";
+        case SCHED_RR: return "SCHED_RR";
+    }
+    return "?";
+}
+
+// Applies the configuration to the calling thread
+inline bool applyThreadRtConfig(const ThreadRtConfig& config, const char* name) {
+    bool ok = true;
+    if (config.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(config.cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            std::cerr << "WARNING: Cannot pin " << name << " thread to CPU " << config.cpu << ": " << strerror(err) << std::endl;
+            ok = false;
+        }
+    }
+    if (config.policy != SCHED_OTHER) {
+        sched_param param;
+        param.sched_priority = config.priority;
+        int err = pthread_setschedparam(pthread_self(), config.policy, &param);
+        if (err != 0) {
+            std::cerr << "WARNING: Cannot set " << schedPolicyName(config.policy) << " priority " << config.priority
+                      << " for " << name << " thread: " << strerror(err) << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// Touches `bytes` of the calling thread's stack so later calls never fault
+// on it. Must not be inlined, or the array would live in the caller's frame.
+__attribute__((noinline)) inline void prefaultStack(size_t bytes) {
+    volatile unsigned char* stack = static_cast<volatile unsigned char*>(alloca(bytes));
+    long page = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < bytes; i += page) stack[i] = 0;
+}
+
+// Locks current and future mappings into RAM and prefaults `stack_bytes`
+// of stack and `heap_bytes` of heap. The heap is kept by the allocator
+// (no trimming, no mmap for large blocks), so later allocations reuse the
+// faulted pages. Call it before the model is loaded, so the model is
+// locked and resident as well.
+inline bool lockAndPrefaultMemory(size_t stack_bytes, size_t heap_bytes) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        std::cerr << "WARNING: mlockall failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    prefaultStack(stack_bytes);
+    if (heap_bytes > 0) {
+        char* heap = static_cast<char*>(malloc(heap_bytes));
+        if (heap) {
+            long page = sysconf(_SC_PAGESIZE);
+            for (size_t i = 0; i < heap_bytes; i += page) heap[i] = 0;
+            free(heap);
+        }
+    }
+    return true;
+}
+
+#endif // RT_THREAD_H
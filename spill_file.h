@@ -0,0 +1,211 @@
+// Overflow storage for capture blocks when the decoder falls behind.
+//
+// A fixed-size circular file of block records, memory-mapped and shared
+// between one producer (the audio callback) and one consumer (the decoder
+// thread), with the same head/tail protocol as BlockRing. The callback
+// preprocesses straight into the mapped record, so spilling costs no extra
+// copy and no system call in the callback; the decoder reads records back
+// at its own pace.
+//
+// The file is preallocated and unlinked right after it is opened, so it
+// never outlives the process. Only the producer's next `ahead` records are
+// kept mapped, and they are mapped writable in advance (by open() and then
+// by the consumer in trimResident()), so the callback does not page-fault
+// as long as it writes no further ahead between two trims. trimResident()
+// drops every other page from the process (MADV_DONTNEED; the data stays
+// in the file and page cache), so RSS stays flat however large the backlog
+// grows.
+//
+// With mlockall(MCL_FUTURE) the whole mapping is locked in memory when it
+// is created and MADV_DONTNEED fails with EINVAL: nothing is trimmed and
+// the file counts fully towards RSS, but locked pages never fault either.
+
+#ifndef SPILL_FILE_H
+#define SPILL_FILE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "stream_dsp.h"
+
+class SpillFile {
+private:
+    struct RecordHeader {
+        uint64_t sequence;
+        uint32_t frames;
+        uint32_t result;
+    };
+
+    char* map = nullptr;
+    size_t map_bytes = 0;
+    size_t capacity = 0;        // records
+    size_t max_frames = 0;
+    size_t record_bytes = 0;
+    size_t page_bytes = 4096;
+    size_t ahead = 1;           // records kept mapped ahead of the producer
+    bool locked = false;        // pages cannot be dropped (mlockall)
+
+    alignas(64) std::atomic<uint64_t> head{0};      // next record to write (producer)
+    uint64_t spilled = 0;                           // producer only
+    alignas(64) std::atomic<uint64_t> tail{0};      // next record to read (consumer)
+
+    RecordHeader* header(uint64_t i) const {
+        return reinterpret_cast<RecordHeader*>(map + (i % capacity) * record_bytes);
+    }
+    short* samples(uint64_t i) const {
+        return reinterpret_cast<short*>(map + (i % capacity) * record_bytes + sizeof(RecordHeader));
+    }
+
+    // Byte ranges, page aligned, of the `ahead` records from the producer's
+    // next one; two if they wrap. Returns the number of ranges.
+    int window(size_t begin[2], size_t end[2]) const {
+        size_t first = head.load(std::memory_order_acquire) % capacity;
+        size_t last = first + ahead;
+        int ranges = 0;
+        if (last > capacity) {
+            begin[ranges] = 0;
+            end[ranges++] = (last - capacity) * record_bytes;
+            last = capacity;
+        }
+        begin[ranges] = first * record_bytes;
+        end[ranges++] = last * record_bytes;
+        for (int i = 0; i < ranges; ++i) {
+            begin[i] = begin[i] / page_bytes * page_bytes;
+            end[i] = std::min(map_bytes, (end[i] + page_bytes - 1) / page_bytes * page_bytes);
+        }
+        return ranges;
+    }
+
+    // Maps the window writable now rather than on the callback's first
+    // write; before Linux 5.14, at least reads it into the page cache
+    void prefaultWindow() {
+        size_t begin[2], end[2];
+        int ranges = window(begin, end);
+        for (int i = 0; i < ranges; ++i) {
+            if (madvise(map + begin[i], end[i] - begin[i], MADV_POPULATE_WRITE) != 0) {
+                madvise(map + begin[i], end[i] - begin[i], MADV_WILLNEED);
+            }
+        }
+    }
+
+public:
+    ~SpillFile() { close(); }
+
+    SpillFile() {}
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    // Creates, preallocates and maps the file. `records` blocks of up to
+    // `frames` samples each; `ahead_records` are kept mapped ahead of the
+    // producer.
+    bool open(const std::string& path, size_t records, size_t frames, size_t ahead_records) {
+        close();
+        capacity = records;
+        max_frames = frames;
+        ahead = std::min(std::max<size_t>(ahead_records, 1), capacity);
+        locked = false;
+        record_bytes = (sizeof(RecordHeader) + frames * sizeof(short) + 15) & ~(size_t)15;
+        map_bytes = capacity * record_bytes;
+        page_bytes = (size_t)sysconf(_SC_PAGESIZE);
+
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0) return false;
+        unlink(path.c_str());
+        // Reserve the blocks now: a write fault on a hole of a full disk
+        // would be a SIGBUS in the callback
+        if (posix_fallocate(fd, 0, map_bytes) != 0) {
+            ::close(fd);
+            return false;
+        }
+        void* p = mmap(nullptr, map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        map = static_cast<char*>(p);
+        head = tail = 0;
+        prefaultWindow();
+        return true;
+    }
+
+    void close() {
+        if (map) munmap(map, map_bytes);
+        map = nullptr;
+    }
+
+    bool isOpen() const { return map != nullptr; }
+
+    // Producer: sample space of the next record, or nullptr if the file is
+    // full
+    short* beginWrite() {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= capacity) return nullptr;
+        return samples(h);
+    }
+
+    // Producer: publishes the record filled after beginWrite()
+    void commitWrite(uint64_t sequence, unsigned long frames, BlockResult result) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        RecordHeader* r = header(h);
+        r->sequence = sequence;
+        r->frames = (uint32_t)frames;
+        r->result = (uint32_t)result;
+        head.store(h + 1, std::memory_order_release);
+        spilled++;
+    }
+
+    // Consumer: sequence number of the oldest record, if any
+    bool frontSequence(uint64_t& sequence) const {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        sequence = header(t)->sequence;
+        return true;
+    }
+
+    // Consumer: copies the oldest record out and removes it
+    bool read(short* out, unsigned long& frames, BlockResult& result, uint64_t& sequence) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+        if (t == h) return false;
+        const RecordHeader* r = header(t);
+        frames = r->frames;
+        result = (BlockResult)r->result;
+        sequence = r->sequence;
+        memcpy(out, samples(t), frames * sizeof(short));
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: unmaps every page outside the producer's next `ahead`
+    // records and maps those in advance. Safe at any time: MAP_SHARED data
+    // lives in the file, and a page read again just faults back in (on the
+    // consumer's thread). Returns false if the pages are locked and
+    // nothing can be trimmed, or on any other madvise error (in errno).
+    bool trimResident() {
+        if (!map || locked) return false;
+        size_t begin[2], end[2];
+        int ranges = window(begin, end);
+        size_t pos = 0;
+        for (int i = 0; i <= ranges; ++i) {
+            size_t gap_end = i < ranges ? begin[i] : map_bytes;
+            if (gap_end > pos && madvise(map + pos, gap_end - pos, MADV_DONTNEED) != 0) {
+                locked = errno == EINVAL;
+                return false;
+            }
+            if (i < ranges) pos = std::max(pos, end[i]);
+        }
+        prefaultWindow();
+        return true;
+    }
+
+    size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+    size_t capacityRecords() const { return capacity; }
+    uint64_t spilledBlocks() const { return spilled; }
+};
+
+#endif // SPILL_FILE_H
@@ -0,0 +1,136 @@
+// Per-stream preprocessing context.
+//
+// Everything the preprocessing chain remembers between blocks - high-pass
+// filter history, AGC gain, the smoothing ring and the gate/endpointer
+// state - lives in one StreamDspState, so any number of streams can be
+// processed side by side, on any threads, without sharing state. The
+// struct is cache-line aligned and the per-block fields sit in the first
+// line; two streams processed on different cores never write to the same
+// cache line.
+
+#ifndef STREAM_DSP_H
+#define STREAM_DSP_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "audio_dsp.h"
+#include "endpointer.h"
+
+#define STREAM_DSP_SMOOTHING_FRAMES (8192)  // Smoothing ring size
+
+struct StreamDspConfig {
+    double gate_threshold = 500.0;      // RMS below this is silence
+    float agc_target_level = 8000.0f;   // Mean absolute level AGC aims for
+    float agc_adjustment_rate = 0.1f;   // Fraction of the gain error corrected per block
+    unsigned long silence_ms = 1000;    // Gated silence that ends an utterance (0: never)
+    int sample_rate = 16000;
+};
+
+enum class BlockResult {
+    SILENCE,         // gated; nothing to feed
+    SPEECH,          // processed in place; feed it to the recognizer
+    END_OF_SPEECH    // gated, and the silence just reached the endpointer limit
+};
+
+struct alignas(64) StreamDspState {
+    // Hot per-block state
+    float hpf_prev_input = 0.0f;
+    float hpf_prev_output = 0.0f;
+    float gain = 1.0f;
+    uint32_t smooth_head = 0;
+    uint32_t smooth_count = 0;
+    uint64_t blocks_passed = 0;
+    uint64_t blocks_gated = 0;
+    Endpointer endpointer;
+    StreamDspConfig config;
+
+    // Gain as last published for monitoring threads
+    alignas(64) std::atomic<float> published_gain{1.0f};
+
+    alignas(64) short smooth_ring[STREAM_DSP_SMOOTHING_FRAMES];
+
+    explicit StreamDspState(const StreamDspConfig& cfg = StreamDspConfig())
+        : endpointer(cfg.silence_ms, cfg.sample_rate), config(cfg) {}
+
+    StreamDspState(const StreamDspState&) = delete;
+    StreamDspState& operator=(const StreamDspState&) = delete;
+
+    // Restarts the high-pass filter at `first_sample`, e.g. after a gap in
+    // the audio, so history from before the gap does not ring into the
+    // block that starts with it
+    void restartFilter(short first_sample) {
+        hpf_prev_input = first_sample;
+        hpf_prev_output = 0.0f;
+    }
+
+    // Clears filter history and gate state, e.g. before reusing the context
+    // for another stream. Configuration is kept.
+    void reset() {
+        hpf_prev_input = hpf_prev_output = 0.0f;
+        gain = 1.0f;
+        smooth_head = smooth_count = 0;
+        blocks_passed = blocks_gated = 0;
+        endpointer = Endpointer(config.silence_ms, config.sample_rate);
+        published_gain.store(1.0f, std::memory_order_relaxed);
+    }
+};
+
+// Smoothing ring: keeps recent processed audio. The newest `frames` samples
+// it would hand back are the block itself, so only the ring is written.
+inline void smoothBlock(StreamDspState& s, const short* audio, unsigned long frames) {
+    const uint32_t capacity = STREAM_DSP_SMOOTHING_FRAMES;
+    if (frames > capacity) return;
+    uint32_t first = std::min<uint32_t>(frames, capacity - s.smooth_head);
+    std::copy(audio, audio + first, s.smooth_ring + s.smooth_head);
+    std::copy(audio + first, audio + frames, s.smooth_ring);
+    s.smooth_head = (s.smooth_head + frames) % capacity;
+    s.smooth_count = std::min<uint32_t>(capacity, s.smooth_count + frames);
+}
+
+// Noise gate plus the gate counters and endpointer bookkeeping
+inline BlockResult gateBlock(StreamDspState& s, const short* audio, unsigned long frames) {
+    if (!isAudioAboveNoiseGate(audio, frames, s.config.gate_threshold)) {
+        s.blocks_gated++;
+        return s.endpointer.onSilence(frames) ? BlockResult::END_OF_SPEECH : BlockResult::SILENCE;
+    }
+    s.blocks_passed++;
+    s.endpointer.onSpeech();
+    return BlockResult::SPEECH;
+}
+
+// Runs noise gate -> high-pass filter -> AGC on one block, in place. The
+// block is only modified when the result is SPEECH. For callers that keep
+// recent audio themselves (e.g. by block reference) instead of in the
+// smoothing ring.
+inline BlockResult preprocessBlock(StreamDspState& s, short* audio, unsigned long frames) {
+    BlockResult result = gateBlock(s, audio, frames);
+    if (result != BlockResult::SPEECH) return result;
+
+    applyHighPassFilter(audio, frames, s.hpf_prev_input, s.hpf_prev_output);
+    applyAGC(audio, frames, s.gain, s.config.agc_target_level, s.config.agc_adjustment_rate);
+    s.published_gain.store(s.gain, std::memory_order_relaxed);
+    return BlockResult::SPEECH;
+}
+
+// High-pass filter and AGC on a block the gate passed over, in place, for
+// callers that keep gated audio to feed ahead of the next utterance (e.g.
+// as pre-roll). The filter history carries on into the next speech block;
+// the current gain is applied but not adapted, so silence does not pull it
+// up.
+inline void conditionGatedBlock(StreamDspState& s, short* audio, unsigned long frames) {
+    applyHighPassFilter(audio, frames, s.hpf_prev_input, s.hpf_prev_output);
+    float gain = s.gain;
+    applyAGC(audio, frames, gain, s.config.agc_target_level, 0.0f);
+}
+
+// Runs noise gate -> high-pass filter -> AGC -> smoothing on one block, in
+// place. The block is only modified when the result is SPEECH.
+inline BlockResult processBlock(StreamDspState& s, short* audio, unsigned long frames) {
+    BlockResult result = preprocessBlock(s, audio, frames);
+    if (result == BlockResult::SPEECH) smoothBlock(s, audio, frames);
+    return result;
+}
+
+#endif // STREAM_DSP_H
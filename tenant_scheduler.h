@@ -0,0 +1,365 @@
+// Decides which stream a decoder worker serves next when tenants share a
+// host.
+//
+// Decode work comes in slices of one stream (a job). Jobs belong to a
+// tenant and a class: LIVE streams always go before FILE jobs, so a
+// tenant's batch upload can never delay anyone's live audio. Within a
+// class, tenants with runnable jobs are served by deficit round robin: a
+// tenant's turn lasts until it has used `quantum` seconds of decode CPU,
+// whatever the number or size of its jobs, so a tenant with 500 files gets
+// the same share as a tenant with one. Slice costs are not known up front,
+// so each slice is charged after it ran and an overrun is paid back on the
+// tenant's next turn.
+//
+// A tenant can have a CPU quota, a fraction of all decode CPU (measured
+// with a decaying average). A tenant over its quota is passed over while
+// another tenant of the same class has work; the scheduler never idles a
+// worker because of a quota.
+//
+// Queueing delay is the time from a job having work (a file job being
+// readied, a live stream's oldest undecoded audio being captured) until a
+// worker picks it. Both it and the decode time are kept per tenant.
+//
+// Jobs can belong to a latency SLO class ("results within 300 ms of
+// capture"): each slice's deadline is the time its audio was captured plus
+// the class target, and slices finishing after it count as misses for the
+// class. With setEdf(true) the live class is served earliest deadline
+// first across all tenants instead of by round robin, so a tight-SLO
+// stream overtakes a captioning stream that can still afford to wait.
+
+#ifndef TENANT_SCHEDULER_H
+#define TENANT_SCHEDULER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+enum class JobClass { LIVE, FILE };
+
+class TenantScheduler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    static const int CLASSES = 2;
+
+    struct Tenant {
+        std::string name;
+        double quota = 0.0;                 // fraction of decode CPU, 0 = none
+        double deficit[CLASSES] = {0.0, 0.0};
+        std::deque<size_t> queue[CLASSES];
+        bool listed[CLASSES] = {false, false};
+        double usage = 0.0;                 // decaying decode CPU
+        // Report
+        double cpu_seconds = 0.0;
+        double audio_seconds = 0.0;
+        unsigned long jobs[CLASSES] = {0, 0};
+        unsigned long slices[CLASSES] = {0, 0};
+        double wait_total[CLASSES] = {0.0, 0.0};
+        double wait_max[CLASSES] = {0.0, 0.0};
+    };
+
+    struct Job {
+        size_t tenant;
+        JobClass job_class;
+        int slo = -1;                       // SLO class, -1 = none
+        bool finished = false;
+        bool waiting = false;               // has a future ready time
+        Clock::time_point ready_at;
+        Clock::time_point deadline;
+    };
+
+    struct SloClass {
+        std::string name;
+        double target;                      // seconds from capture to decoded
+        unsigned long slices = 0;
+        unsigned long missed = 0;
+        double latency_total = 0.0;
+        double latency_max = 0.0;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<Tenant> tenants;
+    std::vector<Job> jobs;
+    std::deque<size_t> active[CLASSES];     // tenants with queued jobs, in turn order
+    std::vector<size_t> waiting;            // jobs with a future ready time
+    std::vector<SloClass> slos;
+    bool edf = false;
+    std::vector<size_t> by_deadline;        // EDF: runnable live jobs, a min-heap on deadline
+    size_t unfinished = 0;
+    double quantum;
+    double half_life;
+    double total_usage = 0.0;
+    Clock::time_point last_decay = Clock::now();
+
+    bool laterDeadline(size_t a, size_t b) const { return jobs[a].deadline > jobs[b].deadline; }
+
+    // Called with the lock held
+    void enqueue(size_t job) {
+        Job& j = jobs[job];
+        j.deadline = j.slo >= 0 ? j.ready_at + std::chrono::duration_cast<Clock::duration>(
+                                      std::chrono::duration<double>(slos[j.slo].target))
+                                : Clock::time_point::max();
+        if (edf && j.job_class == JobClass::LIVE) {
+            by_deadline.push_back(job);
+            std::push_heap(by_deadline.begin(), by_deadline.end(),
+                           [this](size_t a, size_t b) { return laterDeadline(a, b); });
+            return;
+        }
+        Tenant& t = tenants[j.tenant];
+        int c = (int)j.job_class;
+        t.queue[c].push_back(job);
+        if (!t.listed[c]) {
+            t.listed[c] = true;
+            active[c].push_back(j.tenant);
+        }
+    }
+
+    void promoteDue(Clock::time_point now) {
+        for (size_t i = 0; i < waiting.size();) {
+            Job& j = jobs[waiting[i]];
+            if (j.ready_at > now) { ++i; continue; }
+            j.waiting = false;
+            enqueue(waiting[i]);
+            waiting[i] = waiting.back();
+            waiting.pop_back();
+        }
+    }
+
+    bool overQuota(const Tenant& t) const {
+        return t.quota > 0.0 && total_usage > 0.0 && t.usage > t.quota * total_usage;
+    }
+
+    // Deficit round robin over the tenants of one class, or for live jobs
+    // under EDF, the earliest deadline
+    bool pick(int c, size_t& job) {
+        if (edf && c == (int)JobClass::LIVE) {
+            if (by_deadline.empty()) return false;
+            std::pop_heap(by_deadline.begin(), by_deadline.end(),
+                          [this](size_t a, size_t b) { return laterDeadline(a, b); });
+            job = by_deadline.back();
+            by_deadline.pop_back();
+            return true;
+        }
+        std::deque<size_t>& turn = active[c];
+        if (turn.empty()) return false;
+        // Pass over tenants above their quota while anyone else has work
+        bool any_within = false;
+        for (size_t t : turn) any_within = any_within || !overQuota(tenants[t]);
+        while (true) {
+            Tenant& t = tenants[turn.front()];
+            if (any_within && overQuota(t)) {
+                turn.push_back(turn.front());
+                turn.pop_front();
+                continue;
+            }
+            if (t.deficit[c] <= 0.0) {
+                t.deficit[c] += quantum;
+                turn.push_back(turn.front());
+                turn.pop_front();
+                continue;
+            }
+            job = t.queue[c].front();
+            t.queue[c].pop_front();
+            if (t.queue[c].empty()) {
+                // Unused credit is not kept while idle; debt is
+                t.deficit[c] = std::min(t.deficit[c], 0.0);
+                t.listed[c] = false;
+                turn.pop_front();
+            }
+            return true;
+        }
+    }
+
+    void decayUsage(Clock::time_point now) {
+        double dt = std::chrono::duration<double>(now - last_decay).count();
+        last_decay = now;
+        double factor = std::exp2(-dt / half_life);
+        total_usage *= factor;
+        for (Tenant& t : tenants) t.usage *= factor;
+    }
+
+public:
+    // quantum_seconds: decode CPU per tenant turn; usage_half_life_seconds:
+    // how fast past usage stops counting against a quota
+    explicit TenantScheduler(double quantum_seconds = 0.02, double usage_half_life_seconds = 10.0)
+        : quantum(quantum_seconds), half_life(usage_half_life_seconds) {}
+
+    TenantScheduler(const TenantScheduler&) = delete;
+    TenantScheduler& operator=(const TenantScheduler&) = delete;
+
+    // Index of the named tenant, added if new
+    size_t tenant(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < tenants.size(); ++i) if (tenants[i].name == name) return i;
+        tenants.emplace_back();
+        tenants.back().name = name;
+        return tenants.size() - 1;
+    }
+
+    void setQuota(size_t tenant_index, double quota) {
+        std::lock_guard<std::mutex> lock(mutex);
+        tenants[tenant_index].quota = quota;
+    }
+
+    // Index of the named SLO class, added (or its target updated)
+    size_t sloClass(const std::string& name, double target_seconds) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < slos.size(); ++i) {
+            if (slos[i].name != name) continue;
+            slos[i].target = target_seconds;
+            return i;
+        }
+        slos.emplace_back();
+        slos.back().name = name;
+        slos.back().target = target_seconds;
+        return slos.size() - 1;
+    }
+
+    // Serve live jobs earliest deadline first; call before adding jobs
+    void setEdf(bool enabled) {
+        std::lock_guard<std::mutex> lock(mutex);
+        edf = enabled;
+    }
+
+    // Registers a job, runnable from `ready_at`. Returns its index.
+    size_t addJob(size_t tenant_index, JobClass job_class, Clock::time_point ready_at, int slo_class = -1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.emplace_back();
+        Job& j = jobs.back();
+        j.tenant = tenant_index;
+        j.job_class = job_class;
+        j.slo = slo_class;
+        j.ready_at = ready_at;
+        j.waiting = true;
+        waiting.push_back(jobs.size() - 1);
+        tenants[tenant_index].jobs[(int)job_class]++;
+        unfinished++;
+        cv.notify_one();
+        return jobs.size() - 1;
+    }
+
+    // Blocks until a job is runnable and returns it, or returns false once
+    // every job has finished
+    bool next(size_t& job) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            Clock::time_point now = Clock::now();
+            promoteDue(now);
+            for (int c = 0; c < CLASSES; ++c) {
+                if (!pick(c, job)) continue;
+                Job& j = jobs[job];
+                Tenant& t = tenants[j.tenant];
+                double wait = std::max(0.0, std::chrono::duration<double>(now - j.ready_at).count());
+                t.slices[c]++;
+                t.wait_total[c] += wait;
+                t.wait_max[c] = std::max(t.wait_max[c], wait);
+                return true;
+            }
+            if (unfinished == 0) return false;
+            if (waiting.empty()) {
+                cv.wait(lock);
+            } else {
+                Clock::time_point earliest = jobs[waiting[0]].ready_at;
+                for (size_t w : waiting) earliest = std::min(earliest, jobs[w].ready_at);
+                cv.wait_until(lock, earliest);
+            }
+        }
+    }
+
+    // Charges a slice to the job's tenant. The job runs again from
+    // `ready_at` unless it has finished.
+    void complete(size_t job, double cpu_seconds, double audio_seconds, bool finished,
+                  Clock::time_point ready_at) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Job& j = jobs[job];
+        Tenant& t = tenants[j.tenant];
+        Clock::time_point now = Clock::now();
+        if (j.slo >= 0 && audio_seconds > 0.0) {
+            SloClass& slo = slos[j.slo];
+            double latency = std::chrono::duration<double>(now - j.ready_at).count();
+            slo.slices++;
+            slo.missed += now > j.deadline;
+            slo.latency_total += latency;
+            slo.latency_max = std::max(slo.latency_max, latency);
+        }
+        decayUsage(now);
+        t.deficit[(int)j.job_class] -= cpu_seconds;
+        t.usage += cpu_seconds;
+        total_usage += cpu_seconds;
+        t.cpu_seconds += cpu_seconds;
+        t.audio_seconds += audio_seconds;
+        if (finished) {
+            j.finished = true;
+            if (--unfinished == 0) cv.notify_all();
+            return;
+        }
+        j.ready_at = ready_at;
+        if (ready_at <= Clock::now()) {
+            enqueue(job);
+        } else {
+            j.waiting = true;
+            waiting.push_back(job);
+        }
+        cv.notify_one();
+    }
+
+    // Per tenant: jobs, decode time and queueing delay by class
+    void printReport(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        double total_cpu = 0.0;
+        for (const Tenant& t : tenants) total_cpu += t.cpu_seconds;
+        out << std::left << std::setw(12) << "tenant" << std::right << std::setw(6) << "live" << std::setw(6)
+            << "files" << std::setw(9) << "quota" << std::setw(9) << "cpu s" << std::setw(8) << "share"
+            << std::setw(10) << "audio s" << std::setw(14) << "live wait ms" << std::setw(14) << "file wait ms"
+            << std::endl;
+        for (const Tenant& t : tenants) {
+            out << std::left << std::setw(12) << t.name << std::right << std::setw(6) << t.jobs[0] << std::setw(6)
+                << t.jobs[1] << std::fixed << std::setprecision(2) << std::setw(9);
+            if (t.quota > 0) out << t.quota; else out << "-";
+            out << std::setw(9) << t.cpu_seconds << std::setw(8) << (total_cpu > 0 ? t.cpu_seconds / total_cpu : 0.0)
+                << std::setprecision(1) << std::setw(10) << t.audio_seconds;
+            for (int c = 0; c < CLASSES; ++c) {
+                std::string wait = "-";
+                if (t.slices[c] > 0) {
+                    std::ostringstream ss;
+                    ss << std::fixed << std::setprecision(1) << t.wait_total[c] * 1000.0 / t.slices[c] << "/"
+                       << t.wait_max[c] * 1000.0;
+                    wait = ss.str();
+                }
+                out << std::setw(14) << wait;
+            }
+            out << std::endl;
+        }
+        out << "(wait: mean/max per slice)" << std::endl;
+    }
+
+    // Per SLO class: slices decoded, deadline misses, capture-to-decoded latency
+    void printSloReport(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (slos.empty()) return;
+        out << "SLO (" << (edf ? "earliest deadline first" : "round robin") << "):" << std::endl;
+        out << std::left << std::setw(12) << "class" << std::right << std::setw(11) << "target ms" << std::setw(9)
+            << "slices" << std::setw(8) << "missed" << std::setw(8) << "miss %" << std::setw(9) << "mean ms"
+            << std::setw(9) << "max ms" << std::endl;
+        for (const SloClass& slo : slos) {
+            if (slo.slices == 0) continue;
+            out << std::left << std::setw(12) << slo.name << std::right << std::fixed << std::setprecision(0)
+                << std::setw(11) << slo.target * 1000.0 << std::setw(9) << slo.slices << std::setw(8) << slo.missed
+                << std::setprecision(1) << std::setw(8) << (slo.slices ? 100.0 * slo.missed / slo.slices : 0.0)
+                << std::setw(9) << (slo.slices ? slo.latency_total * 1000.0 / slo.slices : 0.0)
+                << std::setw(9) << slo.latency_max * 1000.0 << std::endl;
+        }
+    }
+};
+
+#endif // TENANT_SCHEDULER_H
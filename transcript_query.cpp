@@ -0,0 +1,56 @@
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <iomanip>
+
+#include "transcript_store.h"
+
+// Phrase lookup over a transcript store written by voice_w_cbuff.cpp.
+//
+// Usage: transcript_query <store_dir> "<phrase>" [from_epoch_ms [to_epoch_ms]]
+
+static std::string formatEpochMs(int64_t epoch_ms) {
+    time_t secs = static_cast<time_t>(epoch_ms / 1000);
+    struct tm tm_buf;
+    localtime_r(&secs, &tm_buf);
+    char text[32];
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &tm_buf);
+    char millis[8];
+    snprintf(millis, sizeof(millis), ".%03d", static_cast<int>(epoch_ms % 1000));
+    return std::string(text) + millis;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <store_dir> \"<phrase>\" [from_epoch_ms [to_epoch_ms]]" << std::endl;
+        return 1;
+    }
+
+    int64_t from_ms = (argc > 3) ? strtoll(argv[3], nullptr, 10) : INT64_MIN;
+    int64_t to_ms = (argc > 4) ? strtoll(argv[4], nullptr, 10) : INT64_MAX;
+
+    auto open_start = std::chrono::steady_clock::now();
+    TranscriptStore store;
+    if (!store.open(argv[1], true)) {
+        std::cerr << "ERROR: Failed to open transcript store \"" << argv[1] << "\"" << std::endl;
+        return 1;
+    }
+    auto query_start = std::chrono::steady_clock::now();
+    std::vector<PhraseHit> hits = store.findPhrase(argv[2], from_ms, to_ms);
+    auto query_end = std::chrono::steady_clock::now();
+
+    for (const PhraseHit& hit : hits) {
+        std::cout << hit.start_ms << "\t" << hit.end_ms << "\t"
+                  << formatEpochMs(hit.start_ms) << "\tconf "
+                  << std::fixed << std::setprecision(2) << hit.min_conf << std::endl;
+    }
+
+    auto us = [](std::chrono::steady_clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    };
+    std::cerr << hits.size() << " hit(s) in " << store.wordCount() << " stored words"
+              << " (open " << us(query_start - open_start) << " us, query "
+              << us(query_end - query_start) << " us)" << std::endl;
+    return 0;
+}
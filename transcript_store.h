@@ -0,0 +1,497 @@
+// Append-only, memory-mapped store for word-level transcripts.
+//
+// Layout of a store directory:
+//
+//   lexicon.txt        one word per line; the line number is the word id
+//   seg_000001.col     columnar segment: start time, word id, duration and
+//                      confidence arrays, each `capacity` entries long
+//   seg_000001.idx     inverted index for a sealed segment: word id ->
+//                      sorted row numbers
+//
+// Rows are only ever appended. The writer fills the column slots first and
+// publishes them by bumping the row count in the segment header, so a
+// reader mapping the same files never sees a half-written row. When a
+// segment fills up it is sealed: its index is written next to it and a new
+// segment is started. The active segment keeps its postings in memory and
+// rebuilds them from the columns after a restart.
+//
+// Phrase queries look up every phrase word in the index, drive the match
+// from the rarest one and verify the neighbours directly in the word
+// column, so a query touches only a few pages per hit regardless of how
+// many months of audio are stored.
+
+#ifndef TRANSCRIPT_STORE_H
+#define TRANSCRIPT_STORE_H
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TRANSCRIPT_SEGMENT_CAPACITY (1u << 20) // Words per segment (~20 MB file)
+#define TRANSCRIPT_PHRASE_MAX_GAP_MS (1500)    // Longer pauses break a phrase match
+
+struct PhraseHit {
+    int64_t start_ms;  // epoch milliseconds of the first word
+    int64_t end_ms;    // epoch milliseconds of the end of the last word
+    float min_conf;    // lowest word confidence in the phrase
+};
+
+class TranscriptStore {
+private:
+    struct SegmentHeader {
+        char magic[8];
+        uint32_t capacity;
+        uint32_t reserved;
+        uint64_t count;          // published rows
+        int64_t first_start_ms;
+        int64_t last_end_ms;
+        uint8_t pad[24];
+    };
+    static_assert(sizeof(SegmentHeader) == 64, "segment header must stay 64 bytes");
+
+    struct IndexHeader {
+        char magic[8];
+        uint32_t num_terms;
+        uint32_t reserved;
+        uint64_t num_postings;
+    };
+
+    struct IndexTerm {
+        uint32_t word_id;
+        uint32_t count;
+        uint64_t offset;         // into the postings array
+    };
+
+    struct Segment {
+        int number = 0;
+        int fd = -1;
+        void* map = nullptr;
+        size_t map_size = 0;
+        SegmentHeader* header = nullptr;
+        int64_t* start_ms = nullptr;
+        uint32_t* word = nullptr;
+        uint32_t* dur_ms = nullptr;
+        float* conf = nullptr;
+
+        // Sealed segments: mapped index file
+        void* idx_map = nullptr;
+        size_t idx_size = 0;
+        const IndexTerm* terms = nullptr;
+        const uint32_t* postings = nullptr;
+        uint32_t num_terms = 0;
+
+        // Active segment: postings kept in memory until sealing
+        std::unordered_map<uint32_t, std::vector<uint32_t>> live_postings;
+
+        ~Segment() {
+            if (map) munmap(map, map_size);
+            if (idx_map) munmap(idx_map, idx_size);
+            if (fd >= 0) ::close(fd);
+        }
+
+        uint64_t rows() const {
+            return __atomic_load_n(&header->count, __ATOMIC_ACQUIRE);
+        }
+
+        // Returns the row list for a word id, or an empty range.
+        std::pair<const uint32_t*, size_t> lookup(uint32_t id) const {
+            if (terms) {
+                const IndexTerm* end = terms + num_terms;
+                const IndexTerm* t = std::lower_bound(terms, end, id,
+                    [](const IndexTerm& term, uint32_t v) { return term.word_id < v; });
+                if (t == end || t->word_id != id) return {nullptr, 0};
+                return {postings + t->offset, t->count};
+            }
+            auto it = live_postings.find(id);
+            if (it == live_postings.end()) return {nullptr, 0};
+            return {it->second.data(), it->second.size()};
+        }
+    };
+
+    std::string dir;
+    bool read_only = false;
+    std::unordered_map<std::string, uint32_t> word_ids;
+    std::ofstream lexicon_out;
+    std::vector<std::unique_ptr<Segment>> segments;  // oldest first; back() is active
+    uint32_t capacity = TRANSCRIPT_SEGMENT_CAPACITY;
+
+    static size_t segmentBytes(uint32_t cap) {
+        return sizeof(SegmentHeader) + static_cast<size_t>(cap) * (sizeof(int64_t) + 3 * sizeof(uint32_t));
+    }
+
+    std::string segmentPath(int number, const char* ext) const {
+        char name[32];
+        snprintf(name, sizeof(name), "/seg_%06d.%s", number, ext);
+        return dir + name;
+    }
+
+    static void bindColumns(Segment& seg) {
+        char* base = static_cast<char*>(seg.map);
+        uint32_t cap = seg.header->capacity;
+        seg.start_ms = reinterpret_cast<int64_t*>(base + sizeof(SegmentHeader));
+        seg.word = reinterpret_cast<uint32_t*>(seg.start_ms + cap);
+        seg.dur_ms = seg.word + cap;
+        seg.conf = reinterpret_cast<float*>(seg.dur_ms + cap);
+    }
+
+    bool mapSegment(Segment& seg, bool create) {
+        std::string path = segmentPath(seg.number, "col");
+        int flags = read_only ? O_RDONLY : (O_RDWR | (create ? O_CREAT : 0));
+        seg.fd = ::open(path.c_str(), flags, 0644);
+        if (seg.fd < 0) {
+            std::cerr << "TranscriptStore ERROR: cannot open " << path << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (create) {
+            seg.map_size = segmentBytes(capacity);
+            if (ftruncate(seg.fd, seg.map_size) != 0) {
+                std::cerr << "TranscriptStore ERROR: cannot size " << path << ": " << strerror(errno) << std::endl;
+                return false;
+            }
+        } else {
+            struct stat st;
+            if (fstat(seg.fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SegmentHeader)) {
+                std::cerr << "TranscriptStore ERROR: truncated segment " << path << std::endl;
+                return false;
+            }
+            seg.map_size = st.st_size;
+        }
+        int prot = read_only ? PROT_READ : (PROT_READ | PROT_WRITE);
+        seg.map = mmap(nullptr, seg.map_size, prot, MAP_SHARED, seg.fd, 0);
+        if (seg.map == MAP_FAILED) {
+            seg.map = nullptr;
+            std::cerr << "TranscriptStore ERROR: mmap of " << path << " failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+        seg.header = static_cast<SegmentHeader*>(seg.map);
+        if (create) {
+            memcpy(seg.header->magic, "VTSEG01", 8);
+            seg.header->capacity = capacity;
+            seg.header->first_start_ms = INT64_MAX;
+            seg.header->last_end_ms = INT64_MIN;
+        } else if (memcmp(seg.header->magic, "VTSEG01", 8) != 0 ||
+                   segmentBytes(seg.header->capacity) > seg.map_size) {
+            std::cerr << "TranscriptStore ERROR: " << path << " is not a transcript segment." << std::endl;
+            return false;
+        }
+        bindColumns(seg);
+        return true;
+    }
+
+    bool mapIndex(Segment& seg) {
+        std::string path = segmentPath(seg.number, "idx");
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(IndexHeader);
+        if (ok) {
+            seg.idx_size = st.st_size;
+            seg.idx_map = mmap(nullptr, seg.idx_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (seg.idx_map == MAP_FAILED) {
+                seg.idx_map = nullptr;
+                ok = false;
+            }
+        }
+        ::close(fd);
+        if (!ok) return false;
+
+        const IndexHeader* h = static_cast<const IndexHeader*>(seg.idx_map);
+        size_t need = sizeof(IndexHeader) + h->num_terms * sizeof(IndexTerm) + h->num_postings * sizeof(uint32_t);
+        if (memcmp(h->magic, "VTIDX01", 8) != 0 || need > seg.idx_size) {
+            std::cerr << "TranscriptStore WARNING: ignoring damaged index " << path << std::endl;
+            munmap(seg.idx_map, seg.idx_size);
+            seg.idx_map = nullptr;
+            return false;
+        }
+        seg.num_terms = h->num_terms;
+        seg.terms = reinterpret_cast<const IndexTerm*>(h + 1);
+        seg.postings = reinterpret_cast<const uint32_t*>(seg.terms + seg.num_terms);
+        return true;
+    }
+
+    static void rebuildLivePostings(Segment& seg) {
+        seg.live_postings.clear();
+        uint64_t n = seg.rows();
+        for (uint64_t r = 0; r < n; ++r) {
+            seg.live_postings[seg.word[r]].push_back(static_cast<uint32_t>(r));
+        }
+    }
+
+    // Writes the index of the active segment and starts a new one.
+    bool sealActive() {
+        Segment& seg = *segments.back();
+        std::vector<std::pair<uint32_t, std::vector<uint32_t>*>> sorted;
+        sorted.reserve(seg.live_postings.size());
+        uint64_t total = 0;
+        for (auto& kv : seg.live_postings) {
+            sorted.emplace_back(kv.first, &kv.second);
+            total += kv.second.size();
+        }
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        IndexHeader h = {};
+        memcpy(h.magic, "VTIDX01", 8);
+        h.num_terms = static_cast<uint32_t>(sorted.size());
+        h.num_postings = total;
+        std::vector<IndexTerm> terms;
+        terms.reserve(sorted.size());
+        uint64_t offset = 0;
+        for (auto& t : sorted) {
+            terms.push_back({t.first, static_cast<uint32_t>(t.second->size()), offset});
+            offset += t.second->size();
+        }
+
+        // Write to a temporary name and rename so readers never map a partial index.
+        std::string path = segmentPath(seg.number, "idx");
+        std::string tmp = path + ".tmp";
+        FILE* f = fopen(tmp.c_str(), "wb");
+        if (!f) {
+            std::cerr << "TranscriptStore ERROR: cannot write " << tmp << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+                  fwrite(terms.data(), sizeof(IndexTerm), terms.size(), f) == terms.size();
+        for (size_t i = 0; ok && i < sorted.size(); ++i) {
+            const std::vector<uint32_t>& rows = *sorted[i].second;
+            ok = fwrite(rows.data(), sizeof(uint32_t), rows.size(), f) == rows.size();
+        }
+        ok = (fflush(f) == 0) && ok && fsync(fileno(f)) == 0;
+        fclose(f);
+        if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+            std::cerr << "TranscriptStore ERROR: failed to write index " << path << std::endl;
+            unlink(tmp.c_str());
+            return false;
+        }
+        msync(seg.map, seg.map_size, MS_ASYNC);
+        if (mapIndex(seg)) seg.live_postings.clear();
+        return startSegment(seg.number + 1);
+    }
+
+    bool startSegment(int number) {
+        std::unique_ptr<Segment> seg(new Segment());
+        seg->number = number;
+        if (!mapSegment(*seg, true)) return false;
+        segments.push_back(std::move(seg));
+        return true;
+    }
+
+    uint32_t internWord(const std::string& word) {
+        auto it = word_ids.find(word);
+        if (it != word_ids.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(word_ids.size());
+        word_ids.emplace(word, id);
+        // Persist the word before any row refers to it.
+        lexicon_out << word << '\n';
+        lexicon_out.flush();
+        return id;
+    }
+
+public:
+    TranscriptStore() = default;
+    TranscriptStore(const TranscriptStore&) = delete;
+    TranscriptStore& operator=(const TranscriptStore&) = delete;
+    ~TranscriptStore() { close(); }
+
+    // Opens (and, unless read_only, creates) a store directory.
+    bool open(const std::string& store_dir, bool open_read_only = false) {
+        close();
+        dir = store_dir;
+        read_only = open_read_only;
+        if (!read_only && mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            std::cerr << "TranscriptStore ERROR: cannot create " << dir << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        std::ifstream lexicon_in(dir + "/lexicon.txt");
+        std::string line;
+        while (std::getline(lexicon_in, line)) {
+            word_ids.emplace(line, static_cast<uint32_t>(word_ids.size()));
+        }
+        if (!read_only) {
+            lexicon_out.open(dir + "/lexicon.txt", std::ios::app);
+            if (!lexicon_out) {
+                std::cerr << "TranscriptStore ERROR: cannot open " << dir << "/lexicon.txt" << std::endl;
+                return false;
+            }
+        }
+
+        std::vector<int> numbers;
+        if (DIR* d = opendir(dir.c_str())) {
+            while (dirent* e = readdir(d)) {
+                int n = 0;
+                char ext[8] = {0};
+                if (sscanf(e->d_name, "seg_%d.%7s", &n, ext) == 2 && strcmp(ext, "col") == 0) {
+                    numbers.push_back(n);
+                }
+            }
+            closedir(d);
+        } else {
+            std::cerr << "TranscriptStore ERROR: cannot read " << dir << std::endl;
+            return false;
+        }
+        std::sort(numbers.begin(), numbers.end());
+
+        for (int n : numbers) {
+            std::unique_ptr<Segment> seg(new Segment());
+            seg->number = n;
+            if (!mapSegment(*seg, false)) return false;
+            if (!mapIndex(*seg)) rebuildLivePostings(*seg);
+            segments.push_back(std::move(seg));
+        }
+
+        if (read_only) return true;
+        // Only the newest segment may still take rows.
+        if (segments.empty() || segments.back()->terms) {
+            return startSegment(segments.empty() ? 1 : segments.back()->number + 1);
+        }
+        return true;
+    }
+
+    void close() {
+        if (!read_only && !segments.empty()) flush();
+        segments.clear();
+        word_ids.clear();
+        if (lexicon_out.is_open()) lexicon_out.close();
+    }
+
+    bool isOpen() const { return !segments.empty() || (read_only && !dir.empty()); }
+
+    // Appends one recognized word. Times are epoch milliseconds.
+    bool append(const std::string& word, int64_t start_ms, int64_t end_ms, float conf) {
+        if (read_only || segments.empty() || word.empty()) return false;
+        Segment* seg = segments.back().get();
+        if (seg->header->count >= seg->header->capacity) {
+            if (!sealActive()) return false;
+            seg = segments.back().get();
+        }
+        uint32_t id = internWord(word);
+        uint64_t row = seg->header->count;
+        seg->start_ms[row] = start_ms;
+        seg->word[row] = id;
+        seg->dur_ms[row] = static_cast<uint32_t>(std::max<int64_t>(0, end_ms - start_ms));
+        seg->conf[row] = conf;
+        seg->header->first_start_ms = std::min(seg->header->first_start_ms, start_ms);
+        seg->header->last_end_ms = std::max(seg->header->last_end_ms, end_ms);
+        seg->live_postings[id].push_back(static_cast<uint32_t>(row));
+        __atomic_store_n(&seg->header->count, row + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Schedules dirty pages of the active segment for write-back.
+    void flush() {
+        if (read_only || segments.empty()) return;
+        Segment& seg = *segments.back();
+        msync(seg.map, seg.map_size, MS_ASYNC);
+    }
+
+    uint64_t wordCount() const {
+        uint64_t n = 0;
+        for (const auto& seg : segments) n += seg->rows();
+        return n;
+    }
+
+    // Finds every occurrence of a space-separated phrase whose first word
+    // starts within [from_ms, to_ms]. Hits are returned in time order.
+    std::vector<PhraseHit> findPhrase(const std::string& phrase,
+                                      int64_t from_ms = INT64_MIN,
+                                      int64_t to_ms = INT64_MAX) const {
+        std::vector<PhraseHit> hits;
+        std::vector<uint32_t> ids;
+        std::istringstream tokens(phrase);
+        std::string token;
+        while (tokens >> token) {
+            std::transform(token.begin(), token.end(), token.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            auto it = word_ids.find(token);
+            if (it == word_ids.end()) return hits;  // unknown word: no hits anywhere
+            ids.push_back(it->second);
+        }
+        if (ids.empty()) return hits;
+
+        // Row `row` counted from the start of segment `s`; a phrase may run
+        // across a seal into the neighbouring segment
+        auto locate = [this](size_t s, int64_t row) -> std::pair<const Segment*, uint64_t> {
+            while (row < 0) {
+                if (s == 0) return {nullptr, 0};
+                --s;
+                row += static_cast<int64_t>(segments[s]->rows());
+            }
+            while (static_cast<uint64_t>(row) >= segments[s]->rows()) {
+                row -= static_cast<int64_t>(segments[s]->rows());
+                if (++s == segments.size()) return {nullptr, 0};
+            }
+            return {segments[s].get(), static_cast<uint64_t>(row)};
+        };
+
+        // Drive the match from the word with the shortest posting list. The
+        // pivot is chosen over all segments, so an occurrence spanning a seal
+        // is found exactly once: from the segment holding its pivot word.
+        size_t pivot = 0;
+        uint64_t pivot_count = UINT64_MAX;
+        for (size_t k = 0; k < ids.size(); ++k) {
+            uint64_t count = 0;
+            for (const auto& seg : segments) count += seg->lookup(ids[k]).second;
+            if (count < pivot_count) {
+                pivot_count = count;
+                pivot = k;
+            }
+        }
+        if (pivot_count == 0) return hits;
+
+        for (size_t s = 0; s < segments.size(); ++s) {
+            const Segment& seg = *segments[s];
+            if (seg.rows() == 0) continue;
+            if (seg.header->last_end_ms < from_ms) continue;
+            // Only a phrase started in the previous segment can still match
+            if (seg.header->first_start_ms > to_ms &&
+                (s == 0 || segments[s - 1]->header->first_start_ms > to_ms)) continue;
+
+            std::pair<const uint32_t*, size_t> driver = seg.lookup(ids[pivot]);
+            for (size_t i = 0; i < driver.second; ++i) {
+                int64_t first = static_cast<int64_t>(driver.first[i]) - static_cast<int64_t>(pivot);
+                std::pair<const Segment*, uint64_t> at = locate(s, first);
+                if (!at.first || !locate(s, first + static_cast<int64_t>(ids.size()) - 1).first) continue;
+                int64_t first_start = at.first->start_ms[at.second];
+                if (first_start < from_ms || first_start > to_ms) continue;
+
+                bool match = true;
+                float min_conf = at.first->conf[at.second];
+                int64_t prev_end = 0;
+                for (size_t k = 0; k < ids.size() && match; ++k) {
+                    std::pair<const Segment*, uint64_t> r = locate(s, first + static_cast<int64_t>(k));
+                    const Segment& rs = *r.first;
+                    match = rs.word[r.second] == ids[k];
+                    if (match && k > 0) match = rs.start_ms[r.second] - prev_end <= TRANSCRIPT_PHRASE_MAX_GAP_MS;
+                    if (match) {
+                        min_conf = std::min(min_conf, rs.conf[r.second]);
+                        prev_end = rs.start_ms[r.second] + rs.dur_ms[r.second];
+                    }
+                }
+                if (match) hits.push_back({first_start, prev_end, min_conf});
+            }
+        }
+        std::sort(hits.begin(), hits.end(),
+                  [](const PhraseHit& a, const PhraseHit& b) { return a.start_ms < b.start_ms; });
+        return hits;
+    }
+};
+
+#endif // TRANSCRIPT_STORE_H
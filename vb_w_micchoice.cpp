@@ -4,9 +4,11 @@
 #include <atomic> // For std::atomic_bool
 #include <thread>   // For input thread
 #include <chrono>   // For std::this_thread::sleep_for
+#include <string>
 
 // Vosk API (expected in D:\vsk\)
 #include "vosk_api.h"
+#include "grammar_builder.h"
 
 // PortAudio API (expected in D:\vsk\)
 #include <portaudio.h>
@@ -20,6 +22,16 @@ const char *MODEL_PATH = "/mnt/d/vsk/model_english"; // Absolute path to your mo
 #define FRAMES_PER_BUFFER   (1024)    // Number of audio frames per buffer, affects latency
 #define NUM_CHANNELS        (1)       // Mono
 #define PA_SAMPLE_TYPE      (paInt16) // Vosk expects 16-bit PCM
+
+// Phrases the grammar recognizer may return; checked against the model
+// vocabulary at startup. "[unk]" is added by the grammar builder.
+const std::vector<std::string> GRAMMAR_PHRASES = {
+    "supercalifragilisticexpialidocious",
+    "floccinaucinihilipilification",
+    "antidisestablishmentarianism",
+    "pranav",
+    "madhu",
+};
 // --- End Configuration ---
 
 // Global flag to signal threads to stop
@@ -144,8 +156,6 @@ void checkForQuitCommand() {
 
 int main() {
     // 1. Initialize Vosk Model
-    const char *grammar_json = "[\"supercalifragilisticexpialidocious\", \"floccinaucinihilipilification\", \"antidisestablishmentarianism\", \"pranav\",\"madhu\" \"\", \"[unk]\"]";
-
     VoskModel *model = vosk_model_new(MODEL_PATH);
     if (!model) {
         std::cerr << "ERROR: Failed to load Vosk model from \"" << MODEL_PATH << "\"" << std::endl;
@@ -154,8 +164,25 @@ int main() {
     }
     std::cout << "Vosk model loaded successfully." << std::endl;
 
+    // Build the grammar, dropping phrases with words the model cannot recognize
+    GrammarBuilder grammar(model);
+    grammar.addPhrases(GRAMMAR_PHRASES);
+    std::string grammar_json = grammar.json();
+    const GrammarReport& report = grammar.getReport();
+    std::cout << "Grammar: " << grammar.phraseCount() << " of " << report.phrases_in << " phrases kept ("
+              << report.duplicates << " duplicate, " << report.dropped_oov << " with unknown words), built in "
+              << report.build_ms << " ms." << std::endl;
+    for (const std::string& word : report.oov_words) {
+        std::cerr << "WARNING: \"" << word << "\" is not in the model vocabulary." << std::endl;
+    }
+    if (grammar.phraseCount() == 0) {
+        std::cerr << "ERROR: No grammar phrase can be recognized by this model." << std::endl;
+        vosk_model_free(model);
+        return 1;
+    }
+
     // 2. Create Vosk Recognizer
-    VoskRecognizer *recognizer = vosk_recognizer_new_grm(model, (float)SAMPLE_RATE, grammar_json);
+    VoskRecognizer *recognizer = vosk_recognizer_new_grm(model, (float)SAMPLE_RATE, grammar_json.c_str());
     if (!recognizer) {
         std::cerr << "ERROR: Failed to create Vosk recognizer." << std::endl;
         vosk_model_free(model);
@@ -0,0 +1,478 @@
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <time.h>
+// Vosk API
+#include "vosk_api.h"
+#include "vosk_result.h"
+// PortAudio API
+#include <portaudio.h>
+
+// Two-stage cascade for command-and-control:
+//   stage 1: a tiny grammar recognizer listens all the time for trigger words
+//   stage 2: the full-vocabulary recognizer is only fed audio after a trigger,
+//            starting with the buffered pre-roll so the command is not clipped,
+//            and goes back to sleep after its next final result. The pre-roll
+//            is replayed a few blocks per callback, with live audio queued
+//            behind it, so no single callback decodes 1.5 s of audio. Audio
+//            still queued when it goes back to sleep is caught up on by
+//            stage 1 the same way, so a trigger in it is not missed.
+
+// --- Configuration ---
+const char *MODEL_PATH = "/mnt/d/vsk/model";
+
+// Trigger words for stage 1; every entry except "[unk]" wakes stage 2
+const char *TRIGGER_GRAMMAR = "[\"computer\", \"assistant\", \"[unk]\"]";
+
+#define SAMPLE_RATE         (16000)   // Standard for Vosk
+#define FRAMES_PER_BUFFER   (512)
+#define NUM_CHANNELS        (1)       // Mono
+#define PA_SAMPLE_TYPE      (paInt16) // 16-bit PCM
+
+#define CASCADE_PREROLL_MS      (1500)    // Audio replayed into stage 2 on wake-up
+#define CASCADE_MAX_AWAKE_MS    (10000)   // Stage 2 sleeps again after this long without a final
+#define CASCADE_REPLAY_BLOCKS   (2)       // Queued blocks fed to stage 2 per callback while replaying (>= 2)
+// Set to 1 to also run the full model continuously on the same audio, so
+// the exit report compares measured (not estimated) always-on CPU cost
+#define CASCADE_MEASURE_BASELINE (0)
+// --- End Configuration ---
+
+std::atomic<bool> g_request_stop(false);
+
+struct CascadeState {
+    VoskRecognizer *grammar_recognizer = nullptr;
+    VoskRecognizer *full_recognizer = nullptr;
+    VoskRecognizer *baseline_recognizer = nullptr;
+    bool awake = false;
+    bool replaying = false;              // pre-roll (and live audio behind it) still queued
+    bool draining = false;               // asleep, stage 1 catching up on audio still queued
+    unsigned long awake_frames = 0;
+    std::vector<short> replay_block = std::vector<short>(FRAMES_PER_BUFFER);
+};
+
+// Accounting shared with the main thread (written by the PortAudio thread)
+std::atomic<uint64_t> g_audio_frames(0);
+std::atomic<uint64_t> g_awake_frames_total(0);
+std::atomic<uint64_t> g_grammar_cpu_ns(0);
+std::atomic<uint64_t> g_full_cpu_ns(0);
+std::atomic<uint64_t> g_baseline_cpu_ns(0);
+std::atomic<int> g_wakeups(0);
+
+// Keeps the most recent audio so stage 2 can start before the trigger word.
+// While a stage replays it, it is read as a FIFO with live audio appended;
+// popped audio stays available as pre-roll until forgetPlayed().
+class PreRollBuffer {
+private:
+    std::vector<short> buffer;
+    size_t head, count, capacity;
+    size_t history;   // newest samples rewind() may queue again
+
+public:
+    PreRollBuffer(size_t size) : buffer(size), head(0), count(0), capacity(size), history(0) {}
+
+    void push(const short* data, size_t len) {
+        for (size_t i = 0; i < len; ++i) {
+            buffer[head] = data[i];
+            head = (head + 1) % capacity;
+        }
+        count = std::min(capacity, count + len);
+        history = std::min(capacity, history + len);
+    }
+
+    // Queues the whole history again, oldest first
+    void rewind() { count = history; }
+
+    // Popped audio was decoded; only what is still queued is pre-roll now
+    void forgetPlayed() { history = count; }
+
+    // Moves up to `len` samples, oldest first, into `out`; returns how many
+    size_t pop(short* out, size_t len) {
+        size_t n = std::min(len, count);
+        size_t start = (head + capacity - count) % capacity;
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = buffer[(start + i) % capacity];
+        }
+        count -= n;
+        return n;
+    }
+
+    bool empty() const { return count == 0; }
+};
+
+// One block of slack: while replaying, each callback appends a block and
+// takes CASCADE_REPLAY_BLOCKS out, so the queue only shrinks
+PreRollBuffer g_preroll(SAMPLE_RATE * CASCADE_PREROLL_MS / 1000 + FRAMES_PER_BUFFER);
+
+static uint64_t threadCpuNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// Feeds audio and charges the CPU time spent in Vosk to `cpu_ns`
+static int acceptTimed(VoskRecognizer *recognizer, const short *data, int length, std::atomic<uint64_t>& cpu_ns) {
+    uint64_t before = threadCpuNs();
+    int status = vosk_recognizer_accept_waveform_s(recognizer, data, length);
+    cpu_ns += threadCpuNs() - before;
+    return status;
+}
+
+// Fetches a result (result, partial or final) and charges it like acceptTimed
+static const char* resultTimed(const char* (*fetch)(VoskRecognizer*), VoskRecognizer *recognizer,
+                               std::atomic<uint64_t>& cpu_ns) {
+    uint64_t before = threadCpuNs();
+    const char *json = fetch(recognizer);
+    cpu_ns += threadCpuNs() - before;
+    return json;
+}
+
+// True if the grammar result contains any word other than [unk]
+static bool containsTrigger(const std::string& text) {
+    std::istringstream words(text);
+    std::string word;
+    while (words >> word) {
+        if (word != "[unk]") return true;
+    }
+    return false;
+}
+
+static void printFinal(const char *json) {
+    if (json && std::string(json).find("\"text\" : \"\"") == std::string::npos) {
+        std::cout << "Command: " << json << std::endl;
+    }
+}
+
+static void goToSleep(CascadeState *state) {
+    state->awake = false;
+    state->replaying = false;
+    state->awake_frames = 0;
+    uint64_t before = threadCpuNs();
+    vosk_recognizer_reset(state->full_recognizer);
+    g_full_cpu_ns += threadCpuNs() - before;
+    before = threadCpuNs();
+    vosk_recognizer_reset(state->grammar_recognizer);
+    g_grammar_cpu_ns += threadCpuNs() - before;
+    // Audio still queued (mid-replay) came after the final: stage 1 has
+    // not heard it yet, and it is all the pre-roll a new trigger may use
+    g_preroll.forgetPlayed();
+    state->draining = !g_preroll.empty();
+    std::cout << "[Cascade] Full model sleeping." << std::endl;
+}
+
+// Stage 2: feeds one block; returns false once it went back to sleep
+static bool feedFullModel(CascadeState *state, const short *audio_data, unsigned long frames) {
+    g_awake_frames_total += frames;
+    state->awake_frames += frames;
+    int status = acceptTimed(state->full_recognizer, audio_data, frames, g_full_cpu_ns);
+    if (status > 0) {
+        printFinal(resultTimed(vosk_recognizer_result, state->full_recognizer, g_full_cpu_ns));
+        goToSleep(state);
+        return false;
+    }
+    if (state->awake_frames >= (unsigned long)SAMPLE_RATE * CASCADE_MAX_AWAKE_MS / 1000) {
+        printFinal(resultTimed(vosk_recognizer_final_result, state->full_recognizer, g_full_cpu_ns));
+        goToSleep(state);
+        return false;
+    }
+    return true;
+}
+
+// Feeds up to CASCADE_REPLAY_BLOCKS queued blocks to stage 2
+static void replayQueued(CascadeState *state) {
+    for (int i = 0; i < CASCADE_REPLAY_BLOCKS && state->replaying; ++i) {
+        size_t n = g_preroll.pop(state->replay_block.data(), FRAMES_PER_BUFFER);
+        if (n > 0 && !feedFullModel(state, state->replay_block.data(), n)) return;
+        state->replaying = !g_preroll.empty();
+    }
+}
+
+// Stage 1: one block through the grammar; on a trigger, wakes stage 2 and
+// starts replaying the pre-roll (which already includes this block)
+static void listenForTrigger(CascadeState *state, const short *audio_data, unsigned long frames) {
+    int status = acceptTimed(state->grammar_recognizer, audio_data, frames, g_grammar_cpu_ns);
+    const char *json = resultTimed((status > 0) ? vosk_recognizer_result : vosk_recognizer_partial_result,
+                                   state->grammar_recognizer, g_grammar_cpu_ns);
+    std::string text = parseVoskText(json, (status > 0) ? "text" : "partial");
+    if (!containsTrigger(text)) return;
+    std::cout << "[Cascade] Trigger \"" << text << "\" - waking full model." << std::endl;
+    g_wakeups++;
+    state->awake = true;
+    state->awake_frames = 0;
+    state->draining = false;
+    g_preroll.rewind();
+    state->replaying = !g_preroll.empty();
+    replayQueued(state);
+}
+
+static int paCallback(const void *inputBuffer, void *outputBuffer,
+                      unsigned long framesPerBuffer,
+                      const PaStreamCallbackTimeInfo* timeInfo,
+                      PaStreamCallbackFlags statusFlags,
+                      void *userData) {
+    CascadeState *state = (CascadeState*)userData;
+    const short *audio_data = (const short*)inputBuffer;
+
+    if (g_request_stop) {
+        return paComplete;
+    }
+
+    if (inputBuffer == NULL) {
+        return paContinue;
+    }
+
+    g_audio_frames += framesPerBuffer;
+
+    if (state->baseline_recognizer) {
+        if (acceptTimed(state->baseline_recognizer, audio_data, framesPerBuffer, g_baseline_cpu_ns) > 0) {
+            resultTimed(vosk_recognizer_result, state->baseline_recognizer, g_baseline_cpu_ns);
+        }
+    }
+
+    if (state->awake) {
+        // Stage 2: full model until the command is complete. Live audio
+        // queues behind a pre-roll that is still being replayed.
+        if (state->replaying) {
+            g_preroll.push(audio_data, framesPerBuffer);
+            replayQueued(state);
+        } else {
+            feedFullModel(state, audio_data, framesPerBuffer);
+        }
+        return paContinue;
+    }
+
+    // Stage 1: cheap grammar pass, with the audio kept for replay. After
+    // stage 2 slept mid-replay, it first works through the audio left
+    // queued, a few blocks per callback, with live audio queued behind.
+    g_preroll.push(audio_data, framesPerBuffer);
+    if (!state->draining) {
+        listenForTrigger(state, audio_data, framesPerBuffer);
+        return paContinue;
+    }
+    for (int i = 0; i < CASCADE_REPLAY_BLOCKS && state->draining; ++i) {
+        size_t n = g_preroll.pop(state->replay_block.data(), FRAMES_PER_BUFFER);
+        state->draining = !g_preroll.empty();
+        if (n > 0) listenForTrigger(state, state->replay_block.data(), n);
+    }
+
+    return paContinue;
+}
+
+void listAudioDevices() {
+    int numDevices = Pa_GetDeviceCount();
+    std::cout << "\n=== Available Audio Input Devices ===" << std::endl;
+
+    for (int i = 0; i < numDevices; i++) {
+        const PaDeviceInfo* deviceInfo = Pa_GetDeviceInfo(i);
+        if (deviceInfo->maxInputChannels > 0) {
+            std::cout << "Device " << i << ": " << deviceInfo->name;
+            std::cout << " (inputs: " << deviceInfo->maxInputChannels << ")";
+            if (i == Pa_GetDefaultInputDevice()) {
+                std::cout << " [DEFAULT]";
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+int selectAudioDevice() {
+    listAudioDevices();
+
+    std::cout << "Enter device number (or press Enter for default): ";
+    std::string input;
+    std::getline(std::cin, input);
+
+    if (input.empty()) {
+        return Pa_GetDefaultInputDevice();
+    }
+
+    try {
+        int deviceNum = std::stoi(input);
+        const PaDeviceInfo* deviceInfo = Pa_GetDeviceInfo(deviceNum);
+        if (deviceInfo && deviceInfo->maxInputChannels > 0) {
+            return deviceNum;
+        }
+        std::cout << "Invalid device or no input channels. Using default." << std::endl;
+    } catch (...) {
+        std::cout << "Invalid input. Using default device." << std::endl;
+    }
+    return Pa_GetDefaultInputDevice();
+}
+
+void checkForQuitCommand() {
+    std::cout << "\nCascade active: say a trigger word followed by your command." << std::endl;
+    std::cout << ">>> Type 'q' and press Enter to stop recording. <<<\n" << std::endl;
+    char c;
+    while (std::cin.get(c)) {
+        if (c == 'q' || c == 'Q') {
+            g_request_stop = true;
+            break;
+        }
+        if (c == '\n' && g_request_stop) {
+            break;
+        }
+    }
+}
+
+// CPU use as a percentage of one core, per second of audio
+static double cpuPercent(uint64_t cpu_ns, double audio_seconds) {
+    return audio_seconds > 0 ? cpu_ns / 1e7 / audio_seconds : 0.0;
+}
+
+void printCpuReport() {
+    double audio_s = g_audio_frames.load() / (double)SAMPLE_RATE;
+    double awake_s = g_awake_frames_total.load() / (double)SAMPLE_RATE;
+    double cascade_pct = cpuPercent(g_grammar_cpu_ns + g_full_cpu_ns, audio_s);
+
+    std::cout << "\n=== Cascade CPU report ===" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Audio processed:     " << audio_s << " s (" << g_wakeups.load() << " wake-ups, "
+              << (audio_s > 0 ? 100.0 * awake_s / audio_s : 0.0) << "% awake)" << std::endl;
+    std::cout << "  Grammar stage:       " << cpuPercent(g_grammar_cpu_ns, audio_s) << "% of a core" << std::endl;
+    std::cout << "  Full stage:          " << cpuPercent(g_full_cpu_ns, audio_s) << "% of a core" << std::endl;
+    std::cout << "  Cascade total:       " << cascade_pct << "% of a core per stream" << std::endl;
+    if (CASCADE_MEASURE_BASELINE) {
+        std::cout << "  Full model always on: " << cpuPercent(g_baseline_cpu_ns, audio_s)
+                  << "% of a core per stream (measured)" << std::endl;
+    } else if (awake_s > 0) {
+        // Scale the full model's cost while awake up to the whole stream
+        double full_per_audio_s = g_full_cpu_ns / 1e9 / awake_s;
+        std::cout << "  Full model always on: " << full_per_audio_s * 100.0
+                  << "% of a core per stream (extrapolated from awake time)" << std::endl;
+    }
+}
+
+int main() {
+    // 1. Initialize Vosk Model
+    VoskModel *model = vosk_model_new(MODEL_PATH);
+    if (!model) {
+        std::cerr << "ERROR: Failed to load Vosk model from \"" << MODEL_PATH << "\"" << std::endl;
+        std::cerr << "Please ensure the path is correct and model files are present." << std::endl;
+        return 1;
+    }
+    std::cout << "Vosk model loaded successfully." << std::endl;
+
+    // 2. Create the stage 1 and stage 2 recognizers
+    CascadeState state;
+    state.grammar_recognizer = vosk_recognizer_new_grm(model, (float)SAMPLE_RATE, TRIGGER_GRAMMAR);
+    state.full_recognizer = vosk_recognizer_new(model, (float)SAMPLE_RATE);
+    if (CASCADE_MEASURE_BASELINE) {
+        state.baseline_recognizer = vosk_recognizer_new(model, (float)SAMPLE_RATE);
+    }
+    if (!state.grammar_recognizer || !state.full_recognizer ||
+        (CASCADE_MEASURE_BASELINE && !state.baseline_recognizer)) {
+        std::cerr << "ERROR: Failed to create Vosk recognizers." << std::endl;
+        if (state.grammar_recognizer) vosk_recognizer_free(state.grammar_recognizer);
+        if (state.full_recognizer) vosk_recognizer_free(state.full_recognizer);
+        if (state.baseline_recognizer) vosk_recognizer_free(state.baseline_recognizer);
+        vosk_model_free(model);
+        return 1;
+    }
+    vosk_recognizer_set_words(state.full_recognizer, 1);
+
+    auto freeRecognizers = [&]() {
+        vosk_recognizer_free(state.grammar_recognizer);
+        vosk_recognizer_free(state.full_recognizer);
+        if (state.baseline_recognizer) vosk_recognizer_free(state.baseline_recognizer);
+        vosk_model_free(model);
+    };
+
+    // 3. Initialize PortAudio
+    PaError pa_err = Pa_Initialize();
+    if (pa_err != paNoError) {
+        std::cerr << "PortAudio ERROR: Pa_Initialize returned: " << Pa_GetErrorText(pa_err) << std::endl;
+        freeRecognizers();
+        return 1;
+    }
+
+    // 4. Set up PortAudio Stream Parameters
+    PaStreamParameters inputParameters;
+    inputParameters.device = selectAudioDevice();
+    if (inputParameters.device == paNoDevice) {
+        std::cerr << "PortAudio ERROR: No default input device found." << std::endl;
+        Pa_Terminate();
+        freeRecognizers();
+        return 1;
+    }
+    inputParameters.channelCount = NUM_CHANNELS;
+    inputParameters.sampleFormat = PA_SAMPLE_TYPE;
+    inputParameters.suggestedLatency = Pa_GetDeviceInfo(inputParameters.device)->defaultLowInputLatency;
+    inputParameters.hostApiSpecificStreamInfo = NULL;
+
+    // 5. Open PortAudio Stream
+    PaStream *pa_stream;
+    pa_err = Pa_OpenStream(
+                 &pa_stream,
+                 &inputParameters,
+                 NULL,
+                 SAMPLE_RATE,
+                 FRAMES_PER_BUFFER,
+                 paClipOff,
+                 paCallback,
+                 &state);
+
+    if (pa_err != paNoError) {
+        std::cerr << "PortAudio ERROR: Pa_OpenStream returned: " << Pa_GetErrorText(pa_err) << std::endl;
+        Pa_Terminate();
+        freeRecognizers();
+        return 1;
+    }
+
+    // 6. Start PortAudio Stream
+    pa_err = Pa_StartStream(pa_stream);
+    if (pa_err != paNoError) {
+        std::cerr << "PortAudio ERROR: Pa_StartStream returned: " << Pa_GetErrorText(pa_err) << std::endl;
+        Pa_CloseStream(pa_stream);
+        Pa_Terminate();
+        freeRecognizers();
+        return 1;
+    }
+    std::cout << "PortAudio stream started. Using device: " << Pa_GetDeviceInfo(inputParameters.device)->name << std::endl;
+
+    // 7. Start quit checker thread
+    std::thread quit_checker_thread(checkForQuitCommand);
+
+    // 8. Main loop
+    while (!g_request_stop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    std::cout << "\n'q' pressed. Shutting down..." << std::endl;
+
+    if (quit_checker_thread.joinable()) {
+        quit_checker_thread.join();
+    }
+
+    // 9. Stop and Close PortAudio Stream
+    pa_err = Pa_StopStream(pa_stream);
+    if (pa_err != paNoError) {
+        std::cerr << "PortAudio WARNING: Pa_StopStream returned: " << Pa_GetErrorText(pa_err) << std::endl;
+    }
+
+    pa_err = Pa_CloseStream(pa_stream);
+    if (pa_err != paNoError) {
+        std::cerr << "PortAudio WARNING: Pa_CloseStream returned: " << Pa_GetErrorText(pa_err) << std::endl;
+    }
+
+    // 10. Terminate PortAudio
+    Pa_Terminate();
+    std::cout << "PortAudio terminated." << std::endl;
+
+    // 11. Flush a command that was still in progress, with any audio still queued
+    if (state.awake) {
+        while (state.replaying) replayQueued(&state);
+        if (state.awake) printFinal(vosk_recognizer_final_result(state.full_recognizer));
+    }
+
+    printCpuReport();
+
+    // 12. Clean up Vosk resources
+    freeRecognizers();
+    std::cout << "Vosk resources freed. Exiting." << std::endl;
+
+    return 0;
+}
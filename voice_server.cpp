@@ -0,0 +1,1420 @@
+#include <iostream>
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <sstream>
+#include <condition_variable>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <time.h>
+
+#include "vosk_api.h"
+#include "vosk_result.h"
+#include "stream_dsp.h"
+#include "chunk_coalescer.h"
+#include "partial_cadence.h"
+#include "admission_control.h"
+#include "tenant_scheduler.h"
+#include "numa_topology.h"
+#include "model_prefetch.h"
+#include "recognizer_pool.h"
+#include "model_registry.h"
+#include "language_id.h"
+#include "block_tee.h"
+#include "wav_reader.h"
+
+// Multi-stream recognition server. Every WAV file given on the command
+// line is a session (one stream); sessions are spread over worker threads,
+// and each worker interleaves its sessions block by block, the way a live
+// server interleaves concurrent streams. Audio runs through the same
+// preprocessing and gate-driven endpointing as voice_w_cbuff.cpp, as fast
+// as the workers can decode it.
+//
+// NUMA: one VoskModel is loaded per node by a thread pinned to that node,
+// so the model's memory is local to it. Workers are spread over the nodes,
+// pinned to their node, and create their sessions' recognizers there, so
+// decoding never reads model weights across the interconnect.
+//
+// Before the replicas load, the model files are read into the page cache by
+// a pool of threads, so the loaders (one per node) do not each wait on a
+// cold disk.
+//
+// Each worker takes its recognizers from a RecognizerPool that warms them
+// up with synthetic audio; the server reports ready, and the workers start
+// decoding, only once every recognizer is warm.
+//
+// With --models=FILE the server takes its models from a ModelRegistry
+// instead ("name path" per line): <model> is then the name of the default
+// model, a session can pick another with name=file.wav, and models are
+// loaded on first use and evicted least-recently-used once idle if the
+// process goes over --rss-budget-mb. A session holds its model only while
+// it has audio left.
+//
+// --lid=en,de,... (with --models) identifies the language of every session
+// not given a model explicitly: its first seconds of speech are decoded by
+// a small recognizer per candidate (see language_id.h), then the session
+// gets one recognizer of the winning model and the buffered speech is
+// replayed into it.
+//
+// --tee=NAME,NAME... (with --models) decodes every session with each of
+// these models at once. A worker preprocesses its sessions a single time
+// and publishes the blocks through a BlockTee to one decoder thread per
+// model; all of them read the same block, and results are tagged with the
+// model that produced them.
+//
+// --live=MS turns the replay into a live load test: session i arrives i*MS
+// after start and delivers its audio in real time. Sessions go through
+// admission control (admission_control.h): the per-stream RTF measured by
+// the workers gives the load on the decode cores, and as it rises the
+// server stops polling partials, then feeds coarser chunks, then refuses
+// new sessions (waiting up to --admit-wait-ms for room first). Capacity is
+// printed as it changes and, with --capacity-file, rewritten every second.
+//
+// --fair runs every session through a TenantScheduler instead of fixed
+// per-worker round robin, one scheduler per NUMA node shared by that
+// node's workers, so a slice always runs on the node holding its session's
+// recognizer (tenant shares are per node): sessions are given as
+// [live:|caption:|file:][tenant@]file.wav, decode work is handed out in
+// slices, live and caption sessions (played in real time) always go before
+// file jobs, and tenants share the decode CPU by deficit round robin,
+// optionally capped by --quota. Decode time and queueing delay are
+// reported per tenant. Live and caption slices have a latency SLO
+// (--slo-ms) from capture to decoded, and misses are counted per class;
+// --edf serves them earliest deadline first.
+//
+// --hibernate-after=S hands a session's recognizer back to the pool after S
+// seconds of gated silence (after flushing its final result); the session
+// keeps only its gate state and the last --preroll-ms of audio. On speech
+// it takes a warm recognizer from the pool again and the pre-roll is
+// replayed first. Sessions start hibernated and pools are only partly
+// prefilled, so the recognizers resident track the sessions speaking at
+// once rather than the sessions open; the report estimates the memory
+// this saves.
+//
+// Usage: voice_server [options] <model> <workers> [name=]<file.wav>...
+//   --shared-model        load one model on the first node only (for comparison)
+//   --no-pin              leave thread placement to the scheduler
+//   --prefetch-threads=N  model prefetch threads (default 8, 0 = off)
+//   --warmup-seconds=N    synthetic audio per recognizer before ready (default 3, 0 = off)
+//   --models=FILE         model registry list; <model> names the default model
+//   --rss-budget-mb=N     evict idle registry models above this RSS (default 0 = never)
+//   --lid=NAME,NAME...    route sessions by language ID over these registry models
+//   --tee=NAME,NAME...    decode every session with all of these registry models
+//   --live=MS             sessions arrive MS apart and play in real time, with admission control
+//   --shed=P,C,R          load (fraction of decode cores) that drops partials, coarsens chunks,
+//                         refuses sessions (default 0.7,0.85,0.95)
+//   --partials-ms=N       poll partial results every N ms of audio (default 0 = off)
+//   --coarse-chunk-ms=N   decoder chunk when shedding (default 320)
+//   --admit-wait-ms=N     how long a session may wait for room before it is refused (default 0)
+//   --capacity-file=PATH  live capacity as JSON, rewritten every second
+//   --fair                schedule slices across tenants (deficit round robin, live first)
+//   --quota=T:F,...       cap tenant T at fraction F of the decode CPU (with --fair)
+//   --slice-ms=N          audio per file-job slice (default 320)
+//   --slo-ms=C:MS,...     latency SLO per class (default live:300,caption:2000)
+//   --edf                 serve live and caption slices earliest deadline first (with --fair)
+//   --hibernate-after=S   release the recognizer of a session silent for S seconds
+//   --preroll-ms=N        audio before speech replayed on waking (default 300)
+
+#define SAMPLE_RATE             (16000)
+#define FRAMES_PER_BUFFER       (512)
+#define NOISE_GATE_THRESHOLD    (500)
+#define SILENCE_DETECTION_MS    (1000)
+#define AGC_TARGET_LEVEL        (8000)
+#define AGC_ADJUSTMENT_RATE     (0.1f)
+#define TEE_QUEUE_BLOCKS        (256)     // per decoder; the worker waits for the slowest
+#define DEFAULT_STREAM_RTF      (0.3)     // admission estimate until the warm-up is measured
+#define CAPACITY_PRINT_SECONDS  (10)      // capacity line interval (also printed on level changes)
+#define HIBERNATE_POOL_FRACTION (0.25)    // recognizers prefilled per session when hibernating
+#define HIBERNATE_REPORT_SESSIONS (1000)  // memory saving extrapolated to this many sessions
+
+struct Session;
+
+struct ServerConfig {
+    bool shared_model = false;
+    bool pin = true;
+    int workers = 1;
+    int prefetch_threads = 8;
+    double warmup_seconds = 3.0;
+    const char* model_path = nullptr;   // or the default model's name with a registry
+    const char* model_list = nullptr;
+    size_t rss_budget_mb = 0;
+    std::vector<std::string> lid_candidates;
+    std::vector<std::string> tee_models;
+    double live_interval_ms = -1.0;     // < 0: replay as fast as possible, no admission
+    SheddingConfig shedding;
+    int partials_ms = 0;
+    int coarse_chunk_ms = 320;
+    int admit_wait_ms = 0;
+    const char* capacity_file = nullptr;
+    AdmissionController* admission = nullptr;   // set by main in live mode
+    bool fair = false;
+    std::vector<std::pair<std::string, double>> quotas;
+    int slice_ms = 320;
+    std::vector<std::pair<std::string, double>> slo_ms = {{"live", 300.0}, {"caption", 2000.0}};
+    bool edf = false;
+    double hibernate_after = 0.0;       // seconds; 0 = never
+    int preroll_ms = 300;
+    std::vector<std::unique_ptr<TenantScheduler>>* schedulers = nullptr;   // fair mode: one per node
+    std::vector<std::vector<Session*>>* jobs = nullptr;   // fair mode: per node, session of each job
+};
+
+// Registry mode with hibernation: a warm RecognizerPool per model, so a
+// waking session takes a pooled recognizer instead of creating and warming
+// one on its first speech block. A model's pool holds one registry
+// reference while any of the worker's sessions use the model; the last
+// session to leave frees it, so the model can go idle. Thread-safe: in fair
+// mode any worker of the node may finish a session.
+class ModelPools {
+private:
+    struct Entry {
+        std::unique_ptr<RecognizerPool> pool;
+        unsigned long sessions = 0;
+    };
+
+    ModelRegistry* registry;
+    double warmup_seconds;
+    std::map<std::string, Entry> pools;
+    std::mutex mutex;
+    unsigned long closed_created = 0;   // of pools already freed
+    double closed_warmup_ms = 0.0;
+
+public:
+    ModelPools(ModelRegistry* r, double seconds) : registry(r), warmup_seconds(seconds) {}
+
+    ~ModelPools() {
+        for (auto& entry : pools) {
+            entry.second.pool.reset();
+            registry->release(entry.first);
+        }
+    }
+
+    ModelPools(const ModelPools&) = delete;
+    ModelPools& operator=(const ModelPools&) = delete;
+
+    // Counts a session on the model, loading it and creating its pool for
+    // the first one. nullptr if the model does not load.
+    RecognizerPool* join(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& entry = pools[name];
+        if (!entry.pool) {
+            VoskModel* model = registry->acquire(name);
+            if (!model) {
+                pools.erase(name);
+                return nullptr;
+            }
+            entry.pool.reset(new RecognizerPool(model, (float)SAMPLE_RATE, warmup_seconds));
+        }
+        entry.sessions++;
+        return entry.pool.get();
+    }
+
+    // Drops a session whose recognizer is already back in the pool
+    void leave(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pools.find(name);
+        if (it == pools.end() || --it->second.sessions > 0) return;
+        closed_created += it->second.pool->createdCount();
+        closed_warmup_ms += it->second.pool->warmupMs();
+        pools.erase(it);
+        registry->release(name);
+    }
+
+    // Prefills every pool for `fraction` of its sessions
+    void fill(double fraction) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& entry : pools) {
+            entry.second.pool->fill((size_t)std::ceil(entry.second.sessions * fraction));
+        }
+    }
+
+    unsigned long createdCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        unsigned long created = closed_created;
+        for (auto& entry : pools) created += entry.second.pool->createdCount();
+        return created;
+    }
+
+    double warmupMs() {
+        std::lock_guard<std::mutex> lock(mutex);
+        double ms = closed_warmup_ms;
+        for (auto& entry : pools) ms += entry.second.pool->warmupMs();
+        return ms;
+    }
+};
+
+struct Session {
+    std::string name;
+    std::string model_name;   // registry mode only; empty until language ID decides
+    std::unique_ptr<LanguageIdentifier> lid;
+    std::vector<std::string> lid_models;   // candidate models held during language ID
+    std::vector<short> audio;
+    size_t position = 0;
+    bool done = false;
+    VoskRecognizer* recognizer = nullptr;
+    std::unique_ptr<StreamDspState> dsp;
+    std::vector<short> block;
+    std::atomic<unsigned long> finals{0};
+    ChunkCoalescer coalescer{1};
+    std::unique_ptr<PartialCadence> partials;
+    // Live mode
+    double arrival = 0.0;        // seconds after start
+    double admitted_at = -1.0;   // seconds after start; < 0 until admitted
+    bool holds_admission = false;
+    bool refused = false;
+    // Fair mode
+    std::string tenant;
+    bool live = false;
+    std::string slo_class;            // live and caption sessions
+    RecognizerPool* pool = nullptr;   // the pool its recognizer came from
+    size_t node_index = 0;            // node of the worker owning it (and its pool)
+    std::chrono::steady_clock::time_point live_start;
+    // Hibernation
+    unsigned long hibernate_frames = 0;   // 0 = never
+    unsigned long silent_frames = 0;
+    bool hibernating = false;
+    std::vector<short> preroll;           // last gated blocks, a ring
+    size_t preroll_next = 0;
+    size_t preroll_blocks = 0;
+    ModelRegistry* registry = nullptr;
+    ModelPools* model_pools = nullptr;      // registry mode
+    RecognizerPool* model_pool = nullptr;   // its model's, once joined
+    const std::vector<short>* warmup_audio = nullptr;
+    unsigned long hibernations = 0;
+    unsigned long wakes = 0;
+    uint64_t hibernated_frames = 0;
+};
+
+struct WorkerStats {
+    size_t node_index = 0;
+    unsigned long sessions = 0;
+    double audio_seconds = 0.0;
+    double cpu_seconds = 0.0;
+    unsigned long warmed = 0;
+    double dsp_seconds = 0.0;   // tee mode: preprocessing, done once for all models
+    double warmup_ms = 0.0;
+    unsigned long refused = 0;
+    double max_lag = 0.0;       // live mode: furthest any session fell behind real time
+    unsigned long recognizers_ready = 0;   // pool size once warm
+    unsigned long recognizers = 0;         // pool size at the end
+};
+
+// Workers arrive once their recognizers are warm, then wait for main to
+// open the gate
+class ReadyGate {
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    int pending;
+    bool open = false;
+
+public:
+    explicit ReadyGate(int workers) : pending(workers) {}
+
+    void arriveAndWait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        pending--;
+        cv.notify_all();
+        cv.wait(lock, [this]() { return open; });
+    }
+
+    void waitForAll() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this]() { return pending == 0; });
+    }
+
+    void openGate() {
+        std::lock_guard<std::mutex> lock(mutex);
+        open = true;
+        cv.notify_all();
+    }
+};
+
+std::mutex g_output_mutex;
+
+// Recognizers attached to sessions right now, and the most at once
+std::atomic<unsigned long> g_attached{0};
+std::atomic<unsigned long> g_attached_peak{0};
+
+static double threadCpuSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static StreamDspConfig dspConfig() {
+    StreamDspConfig config;
+    config.gate_threshold = NOISE_GATE_THRESHOLD;
+    config.agc_target_level = AGC_TARGET_LEVEL;
+    config.agc_adjustment_rate = AGC_ADJUSTMENT_RATE;
+    config.silence_ms = SILENCE_DETECTION_MS;
+    config.sample_rate = SAMPLE_RATE;
+    return config;
+}
+
+// model: tag for results of a tee decoder
+static void emitFinal(Session& session, const char* result_json, const char* model = nullptr) {
+    std::string text = parseVoskText(result_json, "text");
+    session.finals++;
+    if (text.empty()) return;
+    std::lock_guard<std::mutex> lock(g_output_mutex);
+    std::cout << "[" << session.name << "] ";
+    if (model) std::cout << "(" << model << ") ";
+    std::cout << text << std::endl;
+}
+
+static std::vector<std::string> splitNames(const char* list) {
+    std::vector<std::string> names;
+    std::stringstream ss(list);
+    std::string name;
+    while (std::getline(ss, name, ',')) if (!name.empty()) names.push_back(name);
+    return names;
+}
+
+static void emitPartial(Session& session, const char* partial_json) {
+    std::string text = parseVoskText(partial_json, "partial");
+    std::lock_guard<std::mutex> lock(g_output_mutex);
+    std::cout << "[" << session.name << "] ... " << text << std::endl;
+}
+
+// Feeds processed audio to the recognizer and emits what it produces
+static void feedAudio(Session& session, const short* audio, unsigned long frames, bool partials_allowed) {
+    if (vosk_recognizer_accept_waveform_s(session.recognizer, audio, (int)frames) > 0) {
+        session.dsp->endpointer.onFinal();
+        if (session.partials) session.partials->onFinal();
+        emitFinal(session, vosk_recognizer_result(session.recognizer));
+    } else if (partials_allowed && session.partials && session.partials->onAudio(frames)) {
+        const char* partial_json = vosk_recognizer_partial_result(session.recognizer);
+        if (session.partials->accept(partial_json)) emitPartial(session, partial_json);
+    }
+}
+
+static void feedPendingChunk(Session& session, bool partials_allowed) {
+    if (session.coalescer.empty()) return;
+    feedAudio(session, session.coalescer.data(), session.coalescer.size(), partials_allowed);
+    session.coalescer.consume();
+}
+
+// Ends the utterance after any coalesced audio
+static void emitUtteranceFinal(Session& session) {
+    feedPendingChunk(session, false);
+    if (session.partials) session.partials->onFinal();
+    emitFinal(session, vosk_recognizer_final_result(session.recognizer));
+}
+
+static bool hibernationStep(Session& session, BlockResult block_result);
+
+// Feeds the session's next capture block. Returns false once its audio is
+// exhausted and the last final result was emitted.
+static bool feedBlock(Session& session, bool partials_allowed = true) {
+    if (session.position + FRAMES_PER_BUFFER > session.audio.size()) {
+        if (!session.hibernating) emitUtteranceFinal(session);
+        session.done = true;
+        return false;
+    }
+    std::copy(session.audio.begin() + session.position,
+              session.audio.begin() + session.position + FRAMES_PER_BUFFER, session.block.begin());
+    session.position += FRAMES_PER_BUFFER;
+
+    BlockResult block_result = processBlock(*session.dsp, session.block.data(), FRAMES_PER_BUFFER);
+    if (session.lid) {
+        // Still identifying the language: speech goes to the candidates
+        if (block_result == BlockResult::SPEECH) session.lid->accept(session.block.data(), FRAMES_PER_BUFFER);
+        else if (block_result == BlockResult::END_OF_SPEECH) session.lid->markBoundary();
+        return true;
+    }
+    if (session.hibernate_frames > 0 && hibernationStep(session, block_result)) return true;
+    if (block_result == BlockResult::SPEECH) {
+        // Unless shedding has coarsened the chunks, the block is fed as is
+        if (session.coalescer.getChunkFrames() <= 1 && session.coalescer.empty()) {
+            feedAudio(session, session.block.data(), FRAMES_PER_BUFFER, partials_allowed);
+        } else if (session.coalescer.push(session.block.data(), FRAMES_PER_BUFFER, session.position)) {
+            feedPendingChunk(session, partials_allowed);
+        }
+    } else if (block_result == BlockResult::END_OF_SPEECH) {
+        emitUtteranceFinal(session);
+    } else {
+        feedPendingChunk(session, partials_allowed);   // do not hold a chunk across silence
+    }
+    return true;
+}
+
+// The session's recognizer: from the worker's pool, from its model's pool
+// when hibernating with a registry, or otherwise with a registry a new one
+// on the session's model (holding a reference to it)
+static bool takeRecognizer(Session& session, RecognizerPool& pool, ModelRegistry* registry,
+                           const std::vector<short>& warmup_audio) {
+    if (session.model_pools) {
+        if (!session.model_pool) session.model_pool = session.model_pools->join(session.model_name);
+        session.recognizer = session.model_pool ? session.model_pool->acquire() : nullptr;
+        return session.recognizer != nullptr;
+    }
+    if (!registry) {
+        session.recognizer = pool.acquire();
+        return session.recognizer != nullptr;
+    }
+    VoskModel* model = registry->acquire(session.model_name);
+    if (!model) return false;
+    session.recognizer = vosk_recognizer_new(model, (float)SAMPLE_RATE);
+    if (!session.recognizer) {
+        registry->release(session.model_name);
+        return false;
+    }
+    if (!warmup_audio.empty()) warmUpRecognizer(session.recognizer, warmup_audio);
+    return true;
+}
+
+// Gives the session a warm recognizer and counts it as attached
+static bool attachRecognizer(Session& session, RecognizerPool& pool, ModelRegistry* registry,
+                             const std::vector<short>& warmup_audio) {
+    if (!takeRecognizer(session, pool, registry, warmup_audio)) return false;
+    unsigned long attached = ++g_attached;
+    unsigned long peak = g_attached_peak.load();
+    while (attached > peak && !g_attached_peak.compare_exchange_weak(peak, attached)) {}
+    return true;
+}
+
+static void detachRecognizer(Session& session, RecognizerPool& pool, ModelRegistry* registry) {
+    if (!session.recognizer) return;
+    if (session.model_pool) {
+        session.model_pool->release(session.recognizer);
+    } else if (registry) {
+        vosk_recognizer_free(session.recognizer);
+        registry->release(session.model_name);
+    } else {
+        pool.release(session.recognizer);
+    }
+    session.recognizer = nullptr;
+    g_attached--;
+}
+
+// A finished session: its recognizer goes back and, with model pools, it
+// stops counting on its model, so the model can go idle
+static void finishSession(Session& session, RecognizerPool& pool, ModelRegistry* registry) {
+    detachRecognizer(session, pool, registry);
+    if (!session.model_pool) return;
+    session.model_pools->leave(session.model_name);
+    session.model_pool = nullptr;
+}
+
+// Hibernation: once a session has been silent long enough its recognizer
+// goes back to the pool; while hibernating it keeps gated blocks as
+// pre-roll, filtered and scaled like the speech that may follow, and on
+// speech it attaches a warm recognizer and replays them before the block
+// itself is fed. Returns true if the block was consumed.
+static bool hibernationStep(Session& session, BlockResult block_result) {
+    bool speech = block_result == BlockResult::SPEECH;
+    session.silent_frames = speech ? 0 : session.silent_frames + FRAMES_PER_BUFFER;
+    if (!session.hibernating) {
+        if (session.silent_frames < session.hibernate_frames) return false;
+        emitUtteranceFinal(session);
+        detachRecognizer(session, *session.pool, session.registry);
+        session.hibernating = true;
+        session.hibernations++;
+        session.preroll_blocks = 0;
+    }
+    if (!speech) {
+        session.hibernated_frames += FRAMES_PER_BUFFER;
+        size_t capacity = session.preroll.size() / FRAMES_PER_BUFFER;
+        if (capacity > 0) {
+            conditionGatedBlock(*session.dsp, session.block.data(), FRAMES_PER_BUFFER);
+            std::copy(session.block.begin(), session.block.end(),
+                      session.preroll.begin() + session.preroll_next * FRAMES_PER_BUFFER);
+            session.preroll_next = (session.preroll_next + 1) % capacity;
+            session.preroll_blocks = std::min(session.preroll_blocks + 1, capacity);
+        }
+        return true;
+    }
+    if (!attachRecognizer(session, *session.pool, session.registry, *session.warmup_audio)) {
+        std::cerr << "ERROR: Failed to wake \"" << session.name << "\"; no recognizer" << std::endl;
+        return true;   // stays hibernated; tries again on the next speech block
+    }
+    session.hibernating = false;
+    session.wakes++;
+    size_t capacity = session.preroll.size() / FRAMES_PER_BUFFER;
+    for (size_t i = 0; i < session.preroll_blocks; ++i) {
+        size_t b = (session.preroll_next + capacity - session.preroll_blocks + i) % capacity;
+        feedAudio(session, &session.preroll[b * FRAMES_PER_BUFFER], FRAMES_PER_BUFFER, false);
+    }
+    session.preroll_blocks = 0;
+    return false;
+}
+
+// Starts language identification over the candidate models
+static bool startLanguageId(Session& session, ModelRegistry* registry, const std::vector<std::string>& candidates) {
+    session.lid.reset(new LanguageIdentifier((float)SAMPLE_RATE));
+    for (const std::string& name : candidates) {
+        VoskModel* model = registry->acquire(name);
+        if (!model) continue;
+        session.lid_models.push_back(name);
+        session.lid->addCandidate(name, model, registry->pathOf(name));
+    }
+    return session.lid->candidateCount() > 0;
+}
+
+// Picks the language, attaches a recognizer of its model and replays the
+// speech buffered during identification, with its utterance ends
+static bool routeSession(Session& session, RecognizerPool& pool, ModelRegistry* registry,
+                         const std::vector<short>& warmup_audio) {
+    LanguageIdentifier& lid = *session.lid;
+    size_t best = lid.decide();
+    session.model_name = lid.score(best).name;
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << "[" << session.name << "] language: " << session.model_name << " ("
+                  << std::fixed << std::setprecision(2);
+        for (size_t i = 0; i < lid.candidateCount(); ++i) {
+            std::cout << (i ? ", " : "") << lid.score(i).name << " " << lid.score(i).score();
+        }
+        std::cout << " over " << std::setprecision(1) << lid.bufferedSeconds() << " s)" << std::endl;
+    }
+    bool attached = attachRecognizer(session, pool, registry, warmup_audio);
+    for (const std::string& name : session.lid_models) registry->release(name);
+    session.lid_models.clear();
+    if (attached) {
+        const std::vector<short>& audio = lid.bufferedAudio();
+        std::vector<size_t> ends = lid.utteranceEnds();
+        ends.push_back(audio.size());
+        size_t pos = 0;
+        for (size_t e = 0; e < ends.size(); ++e) {
+            while (pos < ends[e]) {
+                int frames = (int)std::min<size_t>(FRAMES_PER_BUFFER, ends[e] - pos);
+                if (vosk_recognizer_accept_waveform_s(session.recognizer, audio.data() + pos, frames) > 0) {
+                    session.dsp->endpointer.onFinal();
+                    emitFinal(session, vosk_recognizer_result(session.recognizer));
+                }
+                pos += frames;
+            }
+            if (e + 1 < ends.size()) emitFinal(session, vosk_recognizer_final_result(session.recognizer));
+        }
+    }
+    session.lid.reset();
+    return attached;
+}
+
+// Sets up a worker's sessions on its node and gives each a warm recognizer
+// (or starts language ID)
+static void prepareSessions(RecognizerPool& pool, ModelRegistry* registry, ModelPools* model_pools,
+                            const ServerConfig* config, const std::vector<Session*>& sessions,
+                            const std::vector<short>& warmup_audio, WorkerStats* stats) {
+    for (Session* session : sessions) {
+        session->pool = &pool;
+        session->registry = registry;
+        session->model_pools = model_pools;
+        session->warmup_audio = &warmup_audio;
+        session->dsp.reset(new StreamDspState(dspConfig()));
+        session->block.resize(FRAMES_PER_BUFFER);
+        if (config->partials_ms > 0) {
+            session->partials.reset(new PartialCadence(PartialMode::CHANGE, config->partials_ms, SAMPLE_RATE));
+        }
+        if (session->model_name.empty() && registry) {
+            if (startLanguageId(*session, registry, config->lid_candidates)) continue;
+            session->lid.reset();
+            session->model_name = config->model_path;   // no candidate loaded; use the default
+        }
+        if (config->hibernate_after > 0) {
+            // Starts hibernated: a recognizer is attached on the first speech
+            session->hibernate_frames = (unsigned long)(config->hibernate_after * SAMPLE_RATE);
+            session->preroll.resize((config->preroll_ms * SAMPLE_RATE / 1000 + FRAMES_PER_BUFFER - 1)
+                                    / FRAMES_PER_BUFFER * FRAMES_PER_BUFFER);
+            session->hibernating = true;
+            if (model_pools) session->model_pool = model_pools->join(session->model_name);
+            continue;
+        }
+        if (attachRecognizer(*session, pool, registry, warmup_audio)) stats->warmed++;
+        if (!session->recognizer) {
+            std::cerr << "ERROR: Failed to create recognizer for \"" << session->name << "\"" << std::endl;
+            session->done = true;
+        }
+    }
+    if (model_pools) model_pools->fill(HIBERNATE_POOL_FRACTION);
+}
+
+// Recognizers to create up front: one per session, or with hibernation a
+// fraction, since only the sessions speaking hold one
+static size_t poolPrefill(const ServerConfig* config, size_t sessions) {
+    if (config->hibernate_after <= 0) return sessions;
+    return std::min(sessions, (size_t)std::ceil(sessions * HIBERNATE_POOL_FRACTION));
+}
+
+// Live mode: admits a session that has arrived, or refuses it once it has
+// waited --admit-wait-ms for room. Returns true once it is admitted.
+static bool admitSession(Session& session, AdmissionController& admission, double now, int wait_ms,
+                         WorkerStats* stats) {
+    if (admission.admit()) {
+        session.admitted_at = now;
+        session.holds_admission = true;
+        return true;
+    }
+    if ((now - session.arrival) * 1000.0 >= wait_ms) {
+        admission.refuse();
+        session.refused = true;
+        session.done = true;
+        stats->refused++;
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << "[" << session.name << "] refused: server at capacity" << std::endl;
+    }
+    return false;
+}
+
+static void workerMain(const NumaNode* node, VoskModel* model, ModelRegistry* registry,
+                       const ServerConfig* config, ReadyGate* ready, std::vector<Session*> sessions,
+                       WorkerStats* stats) {
+    double warmup_seconds = config->warmup_seconds;
+    if (node) {
+        pinThreadToNode(*node);
+        preferNodeMemory(*node);
+    }
+    // Recognizers and per-stream state are first touched here, on the node
+    RecognizerPool pool(model, (float)SAMPLE_RATE, warmup_seconds);
+    std::unique_ptr<ModelPools> model_pools;
+    std::vector<short> warmup_audio;
+    if (registry && config->hibernate_after > 0) model_pools.reset(new ModelPools(registry, warmup_seconds));
+    else if (registry) warmup_audio = generateWarmupAudio(warmup_seconds, SAMPLE_RATE);
+    else pool.fill(poolPrefill(config, sessions.size()));
+    prepareSessions(pool, registry, model_pools.get(), config, sessions, warmup_audio, stats);
+    stats->warmup_ms = pool.warmupMs() + (model_pools ? model_pools->warmupMs() : 0.0);
+    stats->recognizers_ready = pool.createdCount() + (model_pools ? model_pools->createdCount() : 0);
+    ready->arriveAndWait();
+
+    AdmissionController* admission = config->admission;
+    auto start = std::chrono::steady_clock::now();
+    double cpu_start = threadCpuSeconds();
+    size_t active = sessions.size();
+    while (active > 0) {
+        active = 0;
+        double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        // Shedding applies to every session of the pass
+        LoadLevel level = admission ? admission->level() : LoadLevel::NORMAL;
+        bool partials_allowed = level < LoadLevel::NO_PARTIALS;
+        size_t chunk_frames = level >= LoadLevel::COARSE_CHUNKS ? SAMPLE_RATE * config->coarse_chunk_ms / 1000 : 1;
+        double pass_cpu = admission ? threadCpuSeconds() : 0.0;
+        unsigned long pass_frames = 0;
+        double next_due = now + 0.1;
+        for (Session* session : sessions) {
+            if (admission && !session->done && session->admitted_at < 0) {
+                if (now < session->arrival) {
+                    active++;
+                    next_due = std::min(next_due, session->arrival);
+                    continue;
+                }
+                if (!admitSession(*session, *admission, now, config->admit_wait_ms, stats)) {
+                    if (!session->done) active++;
+                    continue;
+                }
+            }
+            if (!session->done && session->lid &&
+                (session->lid->ready() || session->position + FRAMES_PER_BUFFER > session->audio.size())) {
+                if (routeSession(*session, pool, registry, warmup_audio)) {
+                    stats->warmed++;
+                } else {
+                    std::cerr << "ERROR: Failed to create recognizer for \"" << session->name << "\"" << std::endl;
+                    session->done = true;
+                }
+            }
+            session->coalescer.setChunkFrames(chunk_frames);
+
+            // Live: every block captured by now; replay: one block per pass
+            size_t blocks = 1;
+            if (admission && !session->done) {
+                size_t fed = session->position / FRAMES_PER_BUFFER;
+                // A block is captured, and can be fed, once its last sample is
+                size_t due = (size_t)((now - session->admitted_at) * SAMPLE_RATE / FRAMES_PER_BUFFER);
+                blocks = due > fed ? due - fed : 0;
+                if (blocks > 1) {
+                    stats->max_lag = std::max(stats->max_lag, (blocks - 1) * (double)FRAMES_PER_BUFFER / SAMPLE_RATE);
+                }
+                next_due = std::min(next_due, session->admitted_at + (fed + blocks + 1) * (double)FRAMES_PER_BUFFER / SAMPLE_RATE);
+            }
+            bool more = !session->done;
+            for (size_t b = 0; more && b < blocks; ++b) {
+                more = feedBlock(*session, partials_allowed);
+                if (more) pass_frames += FRAMES_PER_BUFFER;
+            }
+            if (more) {
+                active++;
+                continue;
+            }
+            if (registry) finishSession(*session, pool, registry);   // let its model go idle
+            if (session->holds_admission) {
+                admission->release();
+                session->holds_admission = false;
+            }
+        }
+        if (admission) {
+            admission->recordDecode(pass_frames / (double)SAMPLE_RATE, threadCpuSeconds() - pass_cpu);
+            // Caught up with every session: sleep until the next block is captured
+            double wait = next_due - std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (wait > 0) std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+        }
+    }
+    stats->cpu_seconds = threadCpuSeconds() - cpu_start;
+
+    for (Session* session : sessions) {
+        stats->sessions++;
+        if (!session->refused) stats->audio_seconds += session->audio.size() / (double)SAMPLE_RATE;
+        finishSession(*session, pool, registry);
+    }
+    stats->recognizers = pool.createdCount() + (model_pools ? model_pools->createdCount() : 0);
+}
+
+// Fair mode worker: prepares its share of the sessions on its node like
+// workerMain, then decodes whichever slice its node's TenantScheduler hands
+// out next, from any of the node's workers' sessions. Its own sessions are
+// detached only once every job of the node has finished.
+static void fairWorkerMain(const NumaNode* node, VoskModel* model, ModelRegistry* registry,
+                           const ServerConfig* config, ReadyGate* ready, std::vector<Session*> sessions,
+                           WorkerStats* stats) {
+    if (node) {
+        pinThreadToNode(*node);
+        preferNodeMemory(*node);
+    }
+    RecognizerPool pool(model, (float)SAMPLE_RATE, config->warmup_seconds);
+    std::unique_ptr<ModelPools> model_pools;
+    std::vector<short> warmup_audio;
+    if (registry && config->hibernate_after > 0) model_pools.reset(new ModelPools(registry, config->warmup_seconds));
+    else if (registry) warmup_audio = generateWarmupAudio(config->warmup_seconds, SAMPLE_RATE);
+    else pool.fill(poolPrefill(config, sessions.size()));
+    prepareSessions(pool, registry, model_pools.get(), config, sessions, warmup_audio, stats);
+    stats->warmup_ms = pool.warmupMs() + (model_pools ? model_pools->warmupMs() : 0.0);
+    stats->recognizers_ready = pool.createdCount() + (model_pools ? model_pools->createdCount() : 0);
+    ready->arriveAndWait();
+
+    TenantScheduler& scheduler = *(*config->schedulers)[stats->node_index];
+    const std::vector<Session*>& jobs = (*config->jobs)[stats->node_index];
+    size_t slice_blocks = std::max<size_t>(1, (size_t)config->slice_ms * SAMPLE_RATE / 1000 / FRAMES_PER_BUFFER);
+    size_t job;
+    while (scheduler.next(job)) {
+        Session& session = *jobs[job];
+        if (session.node_index != stats->node_index) {
+            // Its recognizer and pool live on another node
+            std::cerr << "ERROR: Session \"" << session.name << "\" of node " << session.node_index
+                      << " scheduled on node " << stats->node_index << "; dropped." << std::endl;
+            session.done = true;
+            scheduler.complete(job, 0.0, 0.0, true, std::chrono::steady_clock::now());
+            continue;
+        }
+        double cpu_start = threadCpuSeconds();
+        if (!session.done && session.lid &&
+            (session.lid->ready() || session.position + FRAMES_PER_BUFFER > session.audio.size())) {
+            if (routeSession(session, *session.pool, registry, warmup_audio)) {
+                stats->warmed++;
+            } else {
+                std::cerr << "ERROR: Failed to create recognizer for \"" << session.name << "\"" << std::endl;
+                session.done = true;
+            }
+        }
+        // Live: everything captured by now; file: one slice
+        size_t blocks = slice_blocks;
+        if (session.live) {
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - session.live_start).count();
+            size_t due = (size_t)(elapsed * SAMPLE_RATE / FRAMES_PER_BUFFER);   // blocks fully captured
+            size_t fed = session.position / FRAMES_PER_BUFFER;
+            blocks = due > fed ? due - fed : 0;
+        }
+        unsigned long fed_frames = 0;
+        bool more = !session.done;
+        for (size_t b = 0; more && b < blocks; ++b) {
+            more = feedBlock(session);
+            if (more) fed_frames += FRAMES_PER_BUFFER;
+        }
+        if (!more && registry) finishSession(session, *session.pool, registry);   // let its model go idle
+        double cpu = threadCpuSeconds() - cpu_start;
+        stats->cpu_seconds += cpu;
+
+        // A live session runs again once its next block is captured, i.e.
+        // at the end time of that block
+        auto ready_at = std::chrono::steady_clock::now();
+        if (more && session.live) {
+            ready_at = session.live_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>((session.position / FRAMES_PER_BUFFER + 1) * (double)FRAMES_PER_BUFFER / SAMPLE_RATE));
+        }
+        scheduler.complete(job, cpu, fed_frames / (double)SAMPLE_RATE, !more, ready_at);
+    }
+
+    for (Session* session : sessions) {
+        stats->sessions++;
+        stats->audio_seconds += session->audio.size() / (double)SAMPLE_RATE;
+        finishSession(*session, pool, registry);
+    }
+    stats->recognizers = pool.createdCount() + (model_pools ? model_pools->createdCount() : 0);
+}
+
+// Tee mode: decodes every session of a worker with one model, reading the
+// blocks the worker published
+static void teeDecoder(const NumaNode* node, const std::string* model_name, ModelRegistry* registry,
+                       const std::vector<Session*>* sessions, const std::vector<short>* warmup_audio,
+                       BlockTee* tee, size_t consumer, ReadyGate* ready, double* cpu_seconds) {
+    if (node) {
+        pinThreadToNode(*node);
+        preferNodeMemory(*node);
+    }
+    VoskModel* model = registry->acquire(*model_name);
+    std::vector<VoskRecognizer*> recognizers(sessions->size(), nullptr);
+    for (size_t i = 0; model && i < sessions->size(); ++i) {
+        recognizers[i] = vosk_recognizer_new(model, (float)SAMPLE_RATE);
+        if (recognizers[i] && !warmup_audio->empty()) warmUpRecognizer(recognizers[i], *warmup_audio);
+    }
+    if (!model) std::cerr << "ERROR: Tee model \"" << *model_name << "\" did not load." << std::endl;
+    ready->arriveAndWait();
+
+    double cpu_start = threadCpuSeconds();
+    AudioBlockRef block;
+    while (tee->pop(consumer, block)) {
+        VoskRecognizer* recognizer = recognizers[block->stream];
+        if (!recognizer) continue;
+        Session& session = *(*sessions)[block->stream];
+        if (block->end_of_stream || block->result == BlockResult::END_OF_SPEECH) {
+            emitFinal(session, vosk_recognizer_final_result(recognizer), model_name->c_str());
+        } else if (vosk_recognizer_accept_waveform_s(recognizer, block->samples, (int)block->frames) > 0) {
+            emitFinal(session, vosk_recognizer_result(recognizer), model_name->c_str());
+        }
+    }
+    *cpu_seconds = threadCpuSeconds() - cpu_start;
+
+    for (VoskRecognizer* recognizer : recognizers) if (recognizer) vosk_recognizer_free(recognizer);
+    if (model) registry->release(*model_name);
+}
+
+// Tee mode worker: preprocesses its sessions once and publishes every
+// speech block, by reference, to one decoder thread per tee model.
+// Endpointing stays gate-driven; with several recognizers per stream there
+// is no single Vosk final to feed back into it.
+static void teeWorkerMain(const NumaNode* node, VoskModel* /*model*/, ModelRegistry* registry,
+                          const ServerConfig* config, ReadyGate* ready, std::vector<Session*> sessions,
+                          WorkerStats* stats) {
+    if (node) {
+        pinThreadToNode(*node);
+        preferNodeMemory(*node);
+    }
+    for (Session* session : sessions) session->dsp.reset(new StreamDspState(dspConfig()));
+
+    size_t decoders = config->tee_models.size();
+    std::vector<short> warmup_audio = generateWarmupAudio(config->warmup_seconds, SAMPLE_RATE);
+    BlockTee tee(decoders, TEE_QUEUE_BLOCKS);
+    // Queued blocks, one in hand per decoder and one being filled
+    BlockPool pool(TEE_QUEUE_BLOCKS + decoders + 2, FRAMES_PER_BUFFER);
+    ReadyGate decoders_ready((int)decoders);
+    std::vector<double> decoder_cpu(decoders, 0.0);
+    std::vector<std::thread> threads;
+    for (size_t d = 0; d < decoders; ++d) {
+        threads.emplace_back(teeDecoder, node, &config->tee_models[d], registry, &sessions, &warmup_audio,
+                             &tee, d, &decoders_ready, &decoder_cpu[d]);
+    }
+    decoders_ready.waitForAll();
+    stats->warmed = sessions.size() * decoders;
+    ready->arriveAndWait();
+    decoders_ready.openGate();
+
+    double cpu_start = threadCpuSeconds();
+    size_t active = sessions.size();
+    while (active > 0) {
+        active = 0;
+        for (size_t i = 0; i < sessions.size(); ++i) {
+            Session& session = *sessions[i];
+            if (session.done) continue;
+            AudioBlockRef ref = pool.allocate();
+            if (!ref) { active++; continue; }   // cannot happen with the pool sized as above
+            AudioBlock* block = ref.mutableBlock();
+            block->stream = (uint32_t)i;
+            block->sequence = session.position / FRAMES_PER_BUFFER;
+            if (session.position + FRAMES_PER_BUFFER > session.audio.size()) {
+                block->end_of_stream = true;
+                tee.publish(ref);
+                session.done = true;
+                continue;
+            }
+            std::copy(session.audio.begin() + session.position,
+                      session.audio.begin() + session.position + FRAMES_PER_BUFFER, block->samples);
+            block->frames = FRAMES_PER_BUFFER;
+            session.position += FRAMES_PER_BUFFER;
+            block->result = preprocessBlock(*session.dsp, block->samples, FRAMES_PER_BUFFER);
+            if (block->result != BlockResult::SILENCE) tee.publish(ref);
+            active++;
+        }
+    }
+    stats->dsp_seconds = threadCpuSeconds() - cpu_start;
+    tee.close();
+    for (std::thread& t : threads) t.join();
+
+    stats->cpu_seconds = stats->dsp_seconds;
+    for (double cpu : decoder_cpu) stats->cpu_seconds += cpu;
+    for (Session* session : sessions) {
+        stats->sessions++;
+        stats->audio_seconds += session->audio.size() / (double)SAMPLE_RATE;
+    }
+}
+
+// Loads one model per node in parallel, each from a thread pinned to its
+// node, or a single model on the first node
+static std::vector<VoskModel*> loadModels(const NumaTopology& topology, const ServerConfig& config) {
+    size_t count = config.shared_model ? 1 : topology.nodeCount();
+    std::vector<VoskModel*> models(count, nullptr);
+    ModelPrefetcher prefetcher;
+    if (config.prefetch_threads > 0) prefetcher.start(config.model_path, PrefetchMode::THREADS, config.prefetch_threads);
+    std::vector<std::thread> loaders;
+    for (size_t i = 0; i < count; ++i) {
+        loaders.emplace_back([&, i]() {
+            if (config.pin) {
+                pinThreadToNode(topology.node(i));
+                preferNodeMemory(topology.node(i));
+            }
+            auto start = std::chrono::steady_clock::now();
+            models[i] = vosk_model_new(config.model_path);
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            std::lock_guard<std::mutex> lock(g_output_mutex);
+            std::cout << "✓ Model " << (models[i] ? "loaded" : "FAILED") << " on node "
+                      << topology.node(i).id << " (" << ms << " ms)." << std::endl;
+        });
+    }
+    for (std::thread& t : loaders) t.join();
+    prefetcher.wait();
+    if (config.prefetch_threads > 0) {
+        const PrefetchReport& prefetch = prefetcher.getReport();
+        std::cout << "✓ Prefetched " << prefetch.files << " model files (" << prefetch.bytes / (1024 * 1024)
+                  << " MB) with " << config.prefetch_threads << " threads in " << (long)prefetch.prefetch_ms
+                  << " ms." << std::endl;
+    }
+    return models;
+}
+
+static void printReport(const NumaTopology& topology, const std::vector<WorkerStats>& stats, double wall_seconds) {
+    std::cout << "\n=== Server report ===" << std::endl;
+    std::cout << std::left << std::setw(8) << "node" << std::right << std::setw(9) << "workers"
+              << std::setw(10) << "sessions" << std::setw(10) << "audio s" << std::setw(10) << "cpu s"
+              << std::setw(8) << "RTF" << std::endl;
+    double total_audio = 0.0, total_cpu = 0.0;
+    for (size_t n = 0; n < topology.nodeCount(); ++n) {
+        unsigned long workers = 0, sessions = 0;
+        double audio = 0.0, cpu = 0.0;
+        for (const WorkerStats& s : stats) {
+            if (s.node_index != n) continue;
+            workers++;
+            sessions += s.sessions;
+            audio += s.audio_seconds;
+            cpu += s.cpu_seconds;
+        }
+        if (workers == 0) continue;
+        total_audio += audio;
+        total_cpu += cpu;
+        std::cout << std::left << std::setw(8) << topology.node(n).id << std::right << std::setw(9) << workers
+                  << std::setw(10) << sessions << std::fixed << std::setprecision(1) << std::setw(10) << audio
+                  << std::setw(10) << cpu << std::setprecision(3) << std::setw(8) << (audio > 0 ? cpu / audio : 0.0)
+                  << std::endl;
+    }
+    std::cout << "Total: " << std::setprecision(1) << total_audio << " s of audio in " << wall_seconds
+              << " s wall (" << (wall_seconds > 0 ? total_audio / wall_seconds : 0.0) << "x real time), RTF "
+              << std::setprecision(3) << (total_audio > 0 ? total_cpu / total_audio : 0.0) << std::endl;
+    double dsp = 0.0;
+    for (const WorkerStats& s : stats) dsp += s.dsp_seconds;
+    if (dsp > 0) {
+        std::cout << "Tee: preprocessing " << std::setprecision(2) << dsp << " cpu s, done once for all models"
+                  << std::endl;
+    }
+}
+
+// Hibernation counts, and the recognizer memory it saved: every session
+// would otherwise hold a recognizer. The size of one is the RSS growth of
+// creating the prefilled ones.
+static void printHibernationReport(const std::vector<std::unique_ptr<Session>>& sessions,
+                                   const std::vector<WorkerStats>& stats, unsigned long recognizers_ready,
+                                   size_t rss_growth) {
+    unsigned long hibernations = 0, wakes = 0, resident = 0;
+    uint64_t hibernated = 0, total = 0;
+    for (const std::unique_ptr<Session>& session : sessions) {
+        hibernations += session->hibernations;
+        wakes += session->wakes;
+        hibernated += session->hibernated_frames;
+        total += session->position;
+    }
+    for (const WorkerStats& s : stats) resident += s.recognizers;
+    std::cout << "Hibernation: " << hibernations << " hibernations, " << wakes << " wakes; sessions hibernated "
+              << std::fixed << std::setprecision(1) << (total ? 100.0 * hibernated / total : 0.0)
+              << "% of the time; " << resident << " recognizers resident (peak " << g_attached_peak.load()
+              << " attached) for " << sessions.size() << " sessions" << std::endl;
+    if (recognizers_ready == 0 || rss_growth == 0) return;
+    double recognizer_mb = rss_growth / (1024.0 * 1024.0) / recognizers_ready;
+    double idle_fraction = 1.0 - std::min(1.0, resident / (double)sessions.size());
+    std::cout << "Memory: ~" << recognizer_mb << " MB per recognizer; saved ~"
+              << (sessions.size() - std::min<size_t>(resident, sessions.size())) * recognizer_mb << " MB here, ~"
+              << HIBERNATE_REPORT_SESSIONS * idle_fraction * recognizer_mb / 1024.0 << " GB at "
+              << HIBERNATE_REPORT_SESSIONS << " sessions with the same activity" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    ServerConfig config;
+    int arg = 1;
+    for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; ++arg) {
+        if (strcmp(argv[arg], "--shared-model") == 0) config.shared_model = true;
+        else if (strcmp(argv[arg], "--no-pin") == 0) config.pin = false;
+        else if (strncmp(argv[arg], "--prefetch-threads=", 19) == 0) config.prefetch_threads = atoi(argv[arg] + 19);
+        else if (strncmp(argv[arg], "--warmup-seconds=", 17) == 0) config.warmup_seconds = atof(argv[arg] + 17);
+        else if (strncmp(argv[arg], "--models=", 9) == 0) config.model_list = argv[arg] + 9;
+        else if (strncmp(argv[arg], "--rss-budget-mb=", 16) == 0) config.rss_budget_mb = atol(argv[arg] + 16);
+        else if (strncmp(argv[arg], "--lid=", 6) == 0) config.lid_candidates = splitNames(argv[arg] + 6);
+        else if (strncmp(argv[arg], "--tee=", 6) == 0) config.tee_models = splitNames(argv[arg] + 6);
+        else if (strncmp(argv[arg], "--live=", 7) == 0) config.live_interval_ms = atof(argv[arg] + 7);
+        else if (strncmp(argv[arg], "--shed=", 7) == 0) {
+            if (sscanf(argv[arg] + 7, "%lf,%lf,%lf", &config.shedding.no_partials,
+                       &config.shedding.coarse_chunks, &config.shedding.refuse_new) != 3) {
+                std::cerr << "ERROR: --shed needs three load fractions, e.g. --shed=0.7,0.85,0.95" << std::endl;
+                return 1;
+            }
+        }
+        else if (strncmp(argv[arg], "--partials-ms=", 14) == 0) config.partials_ms = atoi(argv[arg] + 14);
+        else if (strncmp(argv[arg], "--coarse-chunk-ms=", 18) == 0) config.coarse_chunk_ms = atoi(argv[arg] + 18);
+        else if (strncmp(argv[arg], "--admit-wait-ms=", 16) == 0) config.admit_wait_ms = atoi(argv[arg] + 16);
+        else if (strncmp(argv[arg], "--capacity-file=", 16) == 0) config.capacity_file = argv[arg] + 16;
+        else if (strcmp(argv[arg], "--fair") == 0) config.fair = true;
+        else if (strncmp(argv[arg], "--quota=", 8) == 0) {
+            for (const std::string& entry : splitNames(argv[arg] + 8)) {
+                size_t colon = entry.find(':');
+                double quota = colon == std::string::npos ? 0.0 : atof(entry.c_str() + colon + 1);
+                if (quota <= 0.0 || quota > 1.0) {
+                    std::cerr << "ERROR: Bad quota \"" << entry << "\" (expected TENANT:FRACTION)" << std::endl;
+                    return 1;
+                }
+                config.quotas.emplace_back(entry.substr(0, colon), quota);
+            }
+        }
+        else if (strncmp(argv[arg], "--slice-ms=", 11) == 0) config.slice_ms = atoi(argv[arg] + 11);
+        else if (strcmp(argv[arg], "--edf") == 0) config.edf = true;
+        else if (strncmp(argv[arg], "--hibernate-after=", 18) == 0) config.hibernate_after = atof(argv[arg] + 18);
+        else if (strncmp(argv[arg], "--preroll-ms=", 13) == 0) config.preroll_ms = atoi(argv[arg] + 13);
+        else if (strncmp(argv[arg], "--slo-ms=", 9) == 0) {
+            for (const std::string& entry : splitNames(argv[arg] + 9)) {
+                size_t colon = entry.find(':');
+                double ms = colon == std::string::npos ? 0.0 : atof(entry.c_str() + colon + 1);
+                if (ms <= 0.0) {
+                    std::cerr << "ERROR: Bad SLO \"" << entry << "\" (expected CLASS:MS)" << std::endl;
+                    return 1;
+                }
+                std::string name = entry.substr(0, colon);
+                bool found = false;
+                for (auto& slo : config.slo_ms) {
+                    if (slo.first == name) { slo.second = ms; found = true; }
+                }
+                if (!found) config.slo_ms.emplace_back(name, ms);
+            }
+        }
+        else {
+            std::cerr << "ERROR: Unknown option " << argv[arg] << std::endl;
+            return 1;
+        }
+    }
+    if (argc - arg < 3) {
+        std::cerr << "Usage: " << argv[0] << " [--shared-model] [--no-pin] [--prefetch-threads=N] [--warmup-seconds=N]"
+                  << " [--models=FILE] [--rss-budget-mb=N] [--lid=NAME,...] [--tee=NAME,...]"
+                  << " [--live=MS] [--shed=P,C,R] [--partials-ms=N] [--coarse-chunk-ms=N] [--admit-wait-ms=N]"
+                  << " [--capacity-file=PATH] [--fair] [--quota=T:F,...] [--slice-ms=N]"
+                  << " [--slo-ms=C:MS,...] [--edf] [--hibernate-after=S] [--preroll-ms=N] <model> <workers> [name=]<file.wav>..." << std::endl;
+        return 1;
+    }
+    config.model_path = argv[arg];
+    config.workers = atoi(argv[arg + 1]);
+    if (config.workers <= 0) {
+        std::cerr << "ERROR: Need at least one worker." << std::endl;
+        return 1;
+    }
+    if (config.live_interval_ms >= 0 && !config.tee_models.empty()) {
+        std::cerr << "ERROR: --live and --tee cannot be combined." << std::endl;
+        return 1;
+    }
+    if (config.fair && (config.live_interval_ms >= 0 || !config.tee_models.empty())) {
+        std::cerr << "ERROR: --fair cannot be combined with --live or --tee." << std::endl;
+        return 1;
+    }
+    if (config.hibernate_after > 0 && !config.tee_models.empty()) {
+        std::cerr << "ERROR: --hibernate-after and --tee cannot be combined." << std::endl;
+        return 1;
+    }
+    if (config.edf && !config.fair) {
+        std::cerr << "ERROR: --edf needs --fair." << std::endl;
+        return 1;
+    }
+
+    // 1. Topology
+    NumaTopology topology;
+    topology.detect();
+    std::cout << "NUMA nodes: " << topology.nodeCount() << std::endl;
+    for (size_t n = 0; n < topology.nodeCount(); ++n) {
+        std::cout << "  node " << topology.node(n).id << ": " << topology.node(n).cpus.size() << " CPUs" << std::endl;
+    }
+
+    // 2. Models: loaded now, or by the registry on first use
+    vosk_set_log_level(-1);
+    ModelRegistry registry((size_t)config.rss_budget_mb * 1024 * 1024, config.prefetch_threads);
+    std::vector<VoskModel*> models;
+    if (config.model_list) {
+        int count = registry.loadList(config.model_list);
+        if (count < 0) {
+            std::cerr << "ERROR: Cannot open model list \"" << config.model_list << "\"" << std::endl;
+            return 1;
+        }
+        if (!registry.has(config.model_path)) {
+            std::cerr << "ERROR: Default model \"" << config.model_path << "\" is not in the model list." << std::endl;
+            return 1;
+        }
+        for (const std::string& name : config.lid_candidates) {
+            if (!registry.has(name)) {
+                std::cerr << "ERROR: Language ID model \"" << name << "\" is not in the model list." << std::endl;
+                return 1;
+            }
+        }
+        for (const std::string& name : config.tee_models) {
+            if (!registry.has(name)) {
+                std::cerr << "ERROR: Tee model \"" << name << "\" is not in the model list." << std::endl;
+                return 1;
+            }
+        }
+        if (!config.tee_models.empty() && !config.lid_candidates.empty()) {
+            std::cerr << "ERROR: --tee and --lid cannot be combined." << std::endl;
+            return 1;
+        }
+        registry.setEventCallback([](const ModelEvent& event) {
+            std::lock_guard<std::mutex> lock(g_output_mutex);
+            std::cout << "✓ Model \"" << event.name << "\" " << modelEventName(event.type) << " in " << (long)event.ms
+                      << " ms (RSS " << event.rss_before / (1024 * 1024) << " -> " << event.rss_after / (1024 * 1024)
+                      << " MB)." << std::endl;
+        });
+        std::cout << "✓ Model registry: " << count << " models";
+        if (config.rss_budget_mb > 0) std::cout << ", " << config.rss_budget_mb << " MB RSS budget";
+        std::cout << "." << std::endl;
+    } else {
+        if (!config.lid_candidates.empty() || !config.tee_models.empty()) {
+            std::cerr << "ERROR: --lid and --tee need --models." << std::endl;
+            return 1;
+        }
+        models = loadModels(topology, config);
+    }
+    for (VoskModel* model : models) {
+        if (!model) {
+            std::cerr << "ERROR: Failed to load Vosk model from \"" << config.model_path << "\"" << std::endl;
+            for (VoskModel* m : models) if (m) vosk_model_free(m);
+            return 1;
+        }
+    }
+
+    // 3. Sessions
+    std::vector<std::unique_ptr<Session>> sessions;
+    for (int i = arg + 2; i < argc; ++i) {
+        std::unique_ptr<Session> session(new Session());
+        const char* path = argv[i];
+        if (config.fair) {
+            // [live:|caption:|file:][tenant@]
+            if (strncmp(path, "live:", 5) == 0) {
+                session->live = true;
+                session->slo_class = "live";
+                path += 5;
+            } else if (strncmp(path, "caption:", 8) == 0) {
+                session->live = true;
+                session->slo_class = "caption";
+                path += 8;
+            } else if (strncmp(path, "file:", 5) == 0) {
+                path += 5;
+            }
+            const char* at = strchr(path, '@');
+            session->tenant = at ? std::string(path, at - path) : std::string("default");
+            if (at) path = at + 1;
+        }
+        if (config.model_list) {
+            // Without --lid, sessions not naming a model use the default
+            if (config.lid_candidates.empty()) session->model_name = config.model_path;
+            const char* eq = strchr(path, '=');
+            if (eq && registry.has(std::string(path, eq - path))) {
+                session->model_name.assign(path, eq - path);
+                path = eq + 1;
+            }
+        }
+        int rate = 0;
+        if (!readWavFile(path, session->audio, rate)) continue;
+        if (rate != SAMPLE_RATE) {
+            std::cerr << "WARNING: Skipping \"" << path << "\" (" << rate << " Hz, need " << SAMPLE_RATE << ")" << std::endl;
+            continue;
+        }
+        session->name = path;
+        session->arrival = sessions.size() * config.live_interval_ms / 1000.0;
+        sessions.push_back(std::move(session));
+    }
+    if (sessions.empty()) {
+        std::cerr << "ERROR: No usable audio." << std::endl;
+        for (VoskModel* m : models) vosk_model_free(m);
+        return 1;
+    }
+
+    // 4. Admission control (live mode): one decode core per worker, as far
+    // as the machine has cores
+    std::unique_ptr<AdmissionController> admission;
+    size_t decode_cores = 0;
+    if (config.live_interval_ms >= 0) {
+        size_t cpus = 0;
+        for (size_t n = 0; n < topology.nodeCount(); ++n) cpus += topology.node(n).cpus.size();
+        decode_cores = std::min((size_t)config.workers, std::max<size_t>(cpus, 1));
+        admission.reset(new AdmissionController((double)decode_cores, DEFAULT_STREAM_RTF, config.shedding));
+        config.admission = admission.get();
+    }
+
+    // Fair mode: one scheduler job per session, on a scheduler per node
+    // shared by that node's workers only
+    std::vector<std::unique_ptr<TenantScheduler>> schedulers;
+    std::vector<std::vector<Session*>> jobs(topology.nodeCount());
+    if (config.fair) {
+        for (size_t n = 0; n < topology.nodeCount(); ++n) {
+            TenantScheduler* scheduler = new TenantScheduler();
+            for (const auto& quota : config.quotas) scheduler->setQuota(scheduler->tenant(quota.first), quota.second);
+            scheduler->setEdf(config.edf);
+            schedulers.emplace_back(scheduler);
+        }
+        config.schedulers = &schedulers;
+        config.jobs = &jobs;
+    }
+
+    // 5. Workers: spread over the nodes, sessions round-robin over workers
+    std::vector<std::vector<Session*>> assignment(config.workers);
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        sessions[i]->node_index = (i % config.workers) % topology.nodeCount();
+        assignment[i % config.workers].push_back(sessions[i].get());
+    }
+    std::vector<WorkerStats> stats(config.workers);
+    std::vector<std::thread> workers;
+    ReadyGate ready(config.workers);
+    // Hibernating registry sessions prefill a pool per model: load those
+    // models first, so the RSS growth during warm-up is recognizers only
+    std::vector<std::string> preloaded;
+    if (config.model_list && config.hibernate_after > 0 && config.tee_models.empty()) {
+        for (const std::unique_ptr<Session>& session : sessions) {
+            const std::string& name = session->model_name;   // empty until language ID decides
+            if (name.empty() || std::find(preloaded.begin(), preloaded.end(), name) != preloaded.end()) continue;
+            if (registry.acquire(name)) preloaded.push_back(name);
+        }
+    }
+    auto warmup_start = std::chrono::steady_clock::now();
+    size_t rss_before_recognizers = currentRssBytes();
+    for (int w = 0; w < config.workers; ++w) {
+        size_t node_index = w % topology.nodeCount();
+        stats[w].node_index = node_index;
+        VoskModel* model = config.model_list ? nullptr : models[config.shared_model ? 0 : node_index];
+        ModelRegistry* worker_registry = config.model_list ? &registry : nullptr;
+        const NumaNode* node = config.pin ? &topology.node(node_index) : nullptr;
+        auto worker_main = !config.tee_models.empty() ? teeWorkerMain : config.fair ? fairWorkerMain : workerMain;
+        workers.emplace_back(worker_main, node, model, worker_registry, &config, &ready, assignment[w], &stats[w]);
+    }
+    ready.waitForAll();
+    unsigned long warmed = 0, recognizers_ready = 0;
+    for (const WorkerStats& s : stats) {
+        warmed += s.warmed;
+        recognizers_ready += s.recognizers_ready;
+    }
+    size_t rss_ready = currentRssBytes();
+    for (const std::string& name : preloaded) registry.release(name);
+    std::cout << "✓ Ready: " << warmed << " recognizers warmed up in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - warmup_start).count() << " ms." << std::endl;
+    if (admission) {
+        // The warm-up is the first RTF measurement (a pessimistic one: it
+        // includes each recognizer's cold start)
+        double warmup_ms = 0.0;
+        for (const WorkerStats& s : stats) warmup_ms += s.warmup_ms;
+        if (warmed > 0 && config.warmup_seconds > 0 && warmup_ms > 0) {
+            admission->seed(warmup_ms / 1000.0 / (warmed * config.warmup_seconds));
+        }
+        CapacitySnapshot c = admission->snapshot();
+        std::cout << "✓ Admission control: " << decode_cores << " decode cores, per-stream RTF "
+                  << std::fixed << std::setprecision(3) << c.rtf << ", room for " << c.free_streams
+                  << " streams." << std::endl;
+    }
+    auto wall_start = std::chrono::steady_clock::now();
+    if (config.fair) {
+        // File jobs start runnable now; live sessions play in real time from
+        // here, so their first block is ready one block later
+        auto first_block = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>((double)FRAMES_PER_BUFFER / SAMPLE_RATE));
+        for (const std::unique_ptr<Session>& session : sessions) {
+            session->live_start = wall_start;
+            TenantScheduler& scheduler = *schedulers[session->node_index];
+            int slo = -1;
+            for (const auto& target : config.slo_ms) {
+                if (target.first == session->slo_class) slo = (int)scheduler.sloClass(target.first, target.second / 1000.0);
+            }
+            scheduler.addJob(scheduler.tenant(session->tenant), session->live ? JobClass::LIVE : JobClass::FILE,
+                             session->live ? wall_start + first_block : wall_start, slo);
+            jobs[session->node_index].push_back(session.get());
+        }
+    }
+    ready.openGate();
+    std::vector<double> level_seconds(4, 0.0);
+    if (admission) {
+        // Report capacity while the workers run
+        std::mutex done_mutex;
+        std::condition_variable done_cv;
+        bool done = false;
+        std::thread joiner([&]() {
+            for (std::thread& t : workers) t.join();
+            std::lock_guard<std::mutex> lock(done_mutex);
+            done = true;
+            done_cv.notify_all();
+        });
+        LoadLevel last_level = LoadLevel::NORMAL;
+        auto last_print = wall_start;
+        auto last_sample = wall_start;
+        std::unique_lock<std::mutex> lock(done_mutex);
+        while (!done_cv.wait_for(lock, std::chrono::seconds(1), [&done]() { return done; })) {
+            CapacitySnapshot c = admission->snapshot();
+            auto now = std::chrono::steady_clock::now();
+            level_seconds[(int)c.level] += std::chrono::duration<double>(now - last_sample).count();
+            last_sample = now;
+            if (config.capacity_file && !writeCapacityFile(config.capacity_file, c)) {
+                std::cerr << "WARNING: Cannot write capacity file \"" << config.capacity_file << "\"" << std::endl;
+                config.capacity_file = nullptr;
+            }
+            if (c.level == last_level && now - last_print < std::chrono::seconds(CAPACITY_PRINT_SECONDS)) continue;
+            std::lock_guard<std::mutex> output_lock(g_output_mutex);
+            std::cout << "[Capacity] " << c.active << " streams, load " << std::fixed << std::setprecision(2) << c.load
+                      << " (" << c.headroom << " cores free), RTF " << std::setprecision(3) << c.rtf << ", "
+                      << loadLevelName(c.level) << ", room for " << c.free_streams << " more" << std::endl;
+            last_level = c.level;
+            last_print = now;
+        }
+        lock.unlock();
+        joiner.join();
+    } else {
+        for (std::thread& t : workers) t.join();
+    }
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    // 6. Report and clean up
+    printReport(topology, stats, wall_seconds);
+    if (admission) {
+        CapacitySnapshot c = admission->snapshot();
+        double max_lag = 0.0;
+        for (const WorkerStats& s : stats) max_lag = std::max(max_lag, s.max_lag);
+        std::cout << "Admission: " << c.admitted << " admitted, " << c.refused << " refused; per-stream RTF "
+                  << std::setprecision(3) << c.rtf << " on " << decode_cores << " decode cores; max lag "
+                  << std::setprecision(2) << max_lag << " s" << std::endl;
+        std::cout << "Shedding: " << std::setprecision(1);
+        for (int l = 0; l < 4; ++l) {
+            std::cout << (l ? ", " : "") << loadLevelName((LoadLevel)l) << " " << level_seconds[l] << " s";
+        }
+        std::cout << std::endl;
+    }
+    if (config.hibernate_after > 0) printHibernationReport(sessions, stats, recognizers_ready,
+                                                           rss_ready - std::min(rss_ready, rss_before_recognizers));
+    for (size_t n = 0; n < schedulers.size(); ++n) {
+        if (jobs[n].empty()) continue;
+        if (schedulers.size() > 1) std::cout << "Node " << n << ":" << std::endl;
+        schedulers[n]->printReport(std::cout);
+        schedulers[n]->printSloReport(std::cout);
+    }
+    if (config.model_list) registry.printSummary(std::cout);
+    for (VoskModel* m : models) vosk_model_free(m);
+    return 0;
+}
@@ -6,12 +6,26 @@
 #include <chrono>
 #include <algorithm>
 #include <numeric>
-#include <queue>
 #include <mutex>
 #include <cmath>      // For sqrt()
 #include <iomanip>
+#include <ctime>
 // Vosk API
 #include "vosk_api.h"
+#include "vosk_result.h"
+#include "transcript_store.h"
+#include "keyword_alert.h"
+#include "stream_dsp.h"
+#include "partial_cadence.h"
+#include "chunk_coalescer.h"
+#include "catch_up.h"
+#include "block_ring.h"
+#include "spill_file.h"
+#include "idle_gate.h"
+#include "rt_thread.h"
+#include "jitter_histogram.h"
+#include "model_prefetch.h"
+#include "recognizer_pool.h"
 // PortAudio API
 #include <portaudio.h>
 
@@ -25,192 +39,522 @@ const char *MODEL_PATH = "/mnt/d/vsk/model";
 
 // Audio processing parameters
 #define NOISE_GATE_THRESHOLD    (500)     // Adjust based on your environment
-#define SILENCE_DETECTION_MS    (1000)    // 1 second of silence
-#define AUDIO_BUFFER_SIZE       (8192)    // Circular buffer size
+#define SILENCE_DETECTION_MS    (1000)    // Gated silence that ends an utterance (0 = Vosk decides)
 #define AGC_TARGET_LEVEL        (8000)    // Automatic gain control target
 #define AGC_ADJUSTMENT_RATE     (0.1f)    // How quickly AGC adjusts
 
+// Decoder load
+#define PARTIAL_MODE            (PartialMode::CHANGE) // EVERY_BLOCK, TIME, CHANGE or DISABLED
+#define PARTIAL_INTERVAL_MS     (100)     // Partial polling interval for TIME/CHANGE
+#define THROUGHPUT_MODE         (0)       // 1: feed Vosk in larger chunks, trading latency for CPU
+#define COALESCE_MS             (160)     // Chunk size in throughput mode
+#define COALESCE_MAX_DELAY_MS   (250)     // Pending audio is fed after waiting this long
+// Catch-up mode: while the decoder is behind, skip partials and feed large chunks
+#define CATCHUP_ENTER_BLOCKS    (32)      // Backlog that starts catching up (~1 s; 0 = off)
+#define CATCHUP_EXIT_BLOCKS     (2)       // Backlog at which low-latency mode resumes
+#define CATCHUP_CHUNK_MS        (1000)    // Decoder chunk size while catching up
+// Low-power idle: after this much silence outside an utterance the callback
+// only checks a decimated energy estimate, queues nothing and the decoder sleeps
+#define IDLE_ENTER_MS           (2000)    // 0 = off
+#define IDLE_DECIMATION         (8)       // Every Nth sample is checked while idle
+#define IDLE_WAKE_FRACTION      (0.5)     // Of NOISE_GATE_THRESHOLD: decimated RMS that runs the full gate
+
+// Word-level transcripts are appended here; query with ./transcript_query
+#define TRANSCRIPT_STORE_DIR    "transcripts"
+// One watch phrase per line; matches in partials and finals raise alerts
+#define KEYWORD_WATCH_LIST      "watchlist.txt"
+
+// Capture/decoder threading. The callback only preprocesses; Vosk runs on
+// a decoder thread fed through a queue of this many blocks.
+#define DECODE_QUEUE_BLOCKS     (64)      // ~2 s of capture
+#define RECENT_AUDIO_BLOCKS     (16)      // Processed speech kept by reference (~0.5 s)
+// Lossless overflow: past the high-water mark, blocks go to a memory-mapped
+// spill file and are decoded from there once the decoder catches up
+#define SPILL_FILE_PATH         "capture_spill.tmp" // "" = off: drop blocks when the queue is full
+#define SPILL_HIGH_WATER_BLOCKS (48)      // Queue depth that starts spilling
+#define SPILL_MAX_SECONDS       (600)     // Spill file size
+#define SPILL_TRIM_BLOCKS       (32)      // Spilled blocks read between RSS trims
+#define SPILL_PREFAULT_BLOCKS   (128)     // Spill records kept mapped ahead of the callback (4 s)
+// Real-time scheduling; SCHED_FIFO/SCHED_RR need CAP_SYS_NICE or an rtprio limit
+#define RT_POLICY               (SCHED_OTHER) // SCHED_OTHER (off), SCHED_FIFO or SCHED_RR
+#define RT_CAPTURE_PRIORITY     (80)      // PortAudio callback thread
+#define RT_DECODER_PRIORITY     (70)      // Decoder thread
+#define RT_CAPTURE_CPU          (-1)      // CPU to pin the callback thread to (-1 = any)
+#define RT_DECODER_CPU          (-1)      // CPU to pin the decoder thread to (-1 = any)
+#define RT_LOCK_MEMORY          (0)       // 1: mlockall and prefault at startup (needs CAP_IPC_LOCK or memlock limit)
+#define RT_PREFAULT_STACK_KB    (512)
+#define RT_PREFAULT_HEAP_MB     (64)
+
+// Model loading: read the model files into the page cache in parallel while
+// vosk_model_new() runs (helps most on a cold cache or a network mount)
+#define MODEL_PREFETCH_THREADS  (8)       // 0 = off
+#define MODEL_PREFETCH_MODE     (PrefetchMode::THREADS) // FADVISE, READAHEAD or THREADS
+// Synthetic audio decoded (then reset) before capture starts, so the first
+// real utterance does not pay for the decoder's lazy allocations
+#define WARMUP_SECONDS          (3)       // 0 = off
+
 // --- End Configuration ---
 
 // Global variables
 std::atomic<bool> g_request_stop(false);
-std::string g_last_partial_result_json;
-
-// Audio processing variables
-std::atomic<float> g_current_gain(1.0f);
-std::queue<std::vector<short>> g_audio_queue;
-std::mutex g_audio_mutex;
-
-// Circular buffer for audio smoothing
-class CircularBuffer {
-private:
-    std::vector<short> buffer;
-    size_t head, tail, count, capacity;
-    
-public:
-    CircularBuffer(size_t size) : buffer(size), head(0), tail(0), count(0), capacity(size) {}
-    
-    void push(const short* data, size_t len) {
-        for (size_t i = 0; i < len; ++i) {
-            buffer[head] = data[i];
-            head = (head + 1) % capacity;
-            if (count < capacity) {
-                count++;
-            } else {
-                tail = (tail + 1) % capacity;
+// Wakes the main loop: quit requested, or the decoder fell a second behind
+WakeEvent g_main_event;
+
+// Shared by all streams: transcript persistence and the compiled watch list
+TranscriptStore g_transcript_store;
+KeywordAutomaton g_keyword_automaton;
+
+// Everything one audio stream remembers between callbacks. Passed to the
+// PortAudio callback as userData, so several streams never share state.
+struct VoiceStream {
+    VoskRecognizer *recognizer;
+    StreamDspState dsp;                 // Gate, HPF, AGC and endpointer
+    StreamTimeline timeline;            // Recognizer time -> capture time
+    PartialCadence partial_cadence;     // When to poll partial results
+    ChunkCoalescer coalescer;           // Decoder call batching
+    CatchUpTracker catch_up;            // Decoder thread
+    KeywordScanner keyword_scanner;
+    std::vector<KeywordAlert> keyword_alerts;
+    std::string last_partial_result_json;
+    std::vector<VoskWord> final_words;  // Scratch for storing final results (decoder thread)
+    std::vector<short> block;           // Scratch block when no pool block is free
+    uint64_t captured_frames = 0;       // Capture clock (decoder thread)
+
+    // Callback -> decoder. Every block is written once, into the pool; the
+    // queue, the decoder and the recent-audio history share it by reference.
+    BlockPool pool;
+    BlockRing queue;
+    SpillFile spill;                        // Overflow once the queue is past the high-water mark
+    BlockHistory recent_audio;              // Decoder thread
+    uint64_t captured_blocks = 0;           // Callback thread
+    bool spilling = false;                  // Callback thread
+    size_t max_backlog_blocks = 0;          // Decoder thread
+    std::atomic<bool> vosk_final{false};    // Vosk ended an utterance; reset the endpointer
+    std::atomic<bool> decoder_stop{false};
+    uint64_t next_sequence = 0;             // Decoder thread: blocks before it are in the timeline
+    IdleGate idle;                          // Callback goes idle, nothing is queued
+    uint64_t decoder_wakeups = 0;           // Decoder thread
+
+    // Callback thread only
+    bool capture_rt_applied = false;
+    bool backlog_signalled = false;
+    JitterHistogram callback_jitter;
+    uint64_t input_overflows = 0;
+
+    VoiceStream(VoskRecognizer *r, const StreamDspConfig& dsp_config)
+        : recognizer(r),
+          dsp(dsp_config),
+          partial_cadence(PARTIAL_MODE, PARTIAL_INTERVAL_MS, SAMPLE_RATE),
+          coalescer(THROUGHPUT_MODE ? SAMPLE_RATE * COALESCE_MS / 1000 : 1,
+                    SAMPLE_RATE * COALESCE_MAX_DELAY_MS / 1000),
+          catch_up(CATCHUP_ENTER_BLOCKS, CATCHUP_EXIT_BLOCKS),
+          keyword_scanner(g_keyword_automaton),
+          block(FRAMES_PER_BUFFER),
+          pool(DECODE_QUEUE_BLOCKS + RECENT_AUDIO_BLOCKS + 4, FRAMES_PER_BUFFER),
+          queue(DECODE_QUEUE_BLOCKS),
+          recent_audio(RECENT_AUDIO_BLOCKS),
+          idle((unsigned long)SAMPLE_RATE * IDLE_ENTER_MS / 1000, IDLE_DECIMATION,
+               dsp_config.gate_threshold * IDLE_WAKE_FRACTION, dsp_config.gate_threshold) {}
+};
+
+// Appends the words of a final result to the transcript store
+void storeFinalResult(VoiceStream& stream, const char* result_json) {
+    std::vector<VoskWord>& words = stream.final_words;
+    if (!g_transcript_store.isOpen() || !parseVoskWords(result_json, "result", words) || words.empty()) {
+        return;
+    }
+    for (const VoskWord& w : words) {
+        g_transcript_store.append(w.word,
+                                  stream.timeline.toEpochMs(w.start),
+                                  stream.timeline.toEpochMs(w.end),
+                                  w.conf);
+    }
+    stream.timeline.forgetBefore(words.back().end);
+}
+
+// Prints alerts collected by the keyword scanner
+void reportKeywordAlerts(VoiceStream& stream) {
+    for (const KeywordAlert& alert : stream.keyword_alerts) {
+        int64_t when_ms = (alert.start >= 0)
+            ? stream.timeline.toEpochMs(alert.start)
+            : std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::system_clock::now().time_since_epoch()).count();
+        std::cout << "ALERT:   \"" << *alert.phrase << "\" at " << when_ms << " ms"
+                  << (alert.from_final ? " (final)" : " (partial)") << std::endl;
+    }
+    stream.keyword_alerts.clear();
+}
+
+// Prints, stores and scans a final result
+void handleFinalResult(VoiceStream& stream, const char* final_result_json_cstr, const char* label) {
+    if (final_result_json_cstr && strlen(final_result_json_cstr) > 0) {
+        std::string final_result(final_result_json_cstr);
+
+        if (g_keyword_automaton.phraseCount() > 0) {
+            stream.keyword_scanner.scanFinal(final_result_json_cstr, stream.keyword_alerts);
+            reportKeywordAlerts(stream);
+        }
+
+        // Only show non-empty final results
+        if (final_result.find("\"text\" : \"\"") == std::string::npos) {
+            std::cout << label << final_result << std::endl;
+            storeFinalResult(stream, final_result_json_cstr);
+        }
+    }
+    stream.last_partial_result_json.clear();
+    stream.partial_cadence.onFinal();
+}
+
+// Feeds any coalesced audio and ends the current utterance
+void endUtterance(VoiceStream& stream, const char* label) {
+    int vosk_status = 0;
+    if (!stream.coalescer.empty()) {
+        vosk_status = vosk_recognizer_accept_waveform_s(stream.recognizer, stream.coalescer.data(), stream.coalescer.size());
+        stream.coalescer.consume();
+    }
+    // After an endpoint the utterance is already closed; fetch its result instead
+    handleFinalResult(stream, vosk_status > 0 ? vosk_recognizer_result(stream.recognizer)
+                                              : vosk_recognizer_final_result(stream.recognizer), label);
+}
+
+// Feeds processed audio to Vosk and handles the result
+void decodeAudio(VoiceStream& stream, const short* audio_data, unsigned long fed_frames) {
+    int vosk_status = vosk_recognizer_accept_waveform_s(stream.recognizer, audio_data, fed_frames);
+
+    // No partials while catching up: the user has already moved past this audio
+    if (vosk_status == 0 && !stream.catch_up.active() && stream.partial_cadence.onAudio(fed_frames)) { // Partial result due
+        const char* partial_json_cstr = vosk_recognizer_partial_result(stream.recognizer);
+        if (partial_json_cstr && stream.partial_cadence.accept(partial_json_cstr)) {
+            std::string current_partial_json(partial_json_cstr);
+
+            // The scanner itself advances over the new words only
+            if (g_keyword_automaton.phraseCount() > 0) {
+                stream.keyword_scanner.scanPartial(partial_json_cstr, stream.keyword_alerts);
+                reportKeywordAlerts(stream);
+            }
+            
+            // Enhanced filtering for partial results
+            if (current_partial_json != stream.last_partial_result_json &&
+                current_partial_json.length() > 20) { // Only show substantial partials
+                
+                std::cout << "Partial: " << current_partial_json << std::endl;
+                stream.last_partial_result_json = current_partial_json;
             }
         }
+    } else if (vosk_status > 0) { // Final result
+        stream.vosk_final.store(true, std::memory_order_release); // Endpointer lives on the callback thread
+        handleFinalResult(stream, vosk_recognizer_result(stream.recognizer), "Final:   ");
     }
-    
-    std::vector<short> getSmoothed(size_t len) {
-        std::vector<short> result;
-        if (count < len) return result;
-        
-        result.reserve(len);
-        size_t start = (head >= len) ? head - len : capacity - (len - head);
-        
-        for (size_t i = 0; i < len; ++i) {
-            result.push_back(buffer[(start + i) % capacity]);
+}
+
+// Feeds the coalesced chunk
+void decodeChunk(VoiceStream& stream) {
+    decodeAudio(stream, stream.coalescer.data(), stream.coalescer.size());
+    stream.coalescer.consume();
+}
+
+// Handles one preprocessed block on the decoder thread
+void decodeBlock(VoiceStream& stream, const AudioBlockRef& block) {
+    unsigned long frames = block->frames;
+    BlockResult block_result = block->result;
+
+    // Blocks the callback dropped or skipped while idle still count as
+    // (unfed) capture time
+    if (block->sequence > stream.next_sequence) {
+        unsigned long missing_frames = (block->sequence - stream.next_sequence) * FRAMES_PER_BUFFER;
+        stream.captured_frames += missing_frames;
+        stream.timeline.onBlock(missing_frames, false);
+    }
+    stream.next_sequence = block->sequence + 1;
+
+    stream.captured_frames += frames;
+    stream.timeline.onBlock(frames, block_result == BlockResult::SPEECH);
+    stream.catch_up.onDecoded(frames);
+
+    if (block_result != BlockResult::SPEECH) {
+        // Do not let a partly filled chunk wait for the next utterance
+        if (stream.coalescer.due(stream.captured_frames)) {
+            decodeChunk(stream);
+        }
+        // Vosk never sees gated silence, so end the utterance here
+        if (block_result == BlockResult::END_OF_SPEECH) {
+            endUtterance(stream, "Final:   ");
         }
-        return result;
+        return; // Skip processing if below noise gate
     }
-};
 
-CircularBuffer g_audio_buffer(AUDIO_BUFFER_SIZE);
+    stream.recent_audio.push(block);
 
-// Noise gate function
-bool isAudioAboveNoiseGate(const short* audio_data, unsigned long frame_count) {
-    double rms = 0.0;
-    for (unsigned long i = 0; i < frame_count; ++i) {
-        rms += audio_data[i] * audio_data[i];
+    // Without coalescing the block goes to Vosk straight from the pool
+    if (stream.coalescer.getChunkFrames() <= 1 && stream.coalescer.empty()) {
+        decodeAudio(stream, block->samples, frames);
+        return;
+    }
+    // In throughput mode, wait until a full chunk is collected
+    if (stream.coalescer.push(block->samples, frames, stream.captured_frames)) {
+        decodeChunk(stream);
     }
-    rms = sqrt(rms / frame_count);
-    return rms > NOISE_GATE_THRESHOLD;
 }
 
-// Simple high-pass filter to remove DC offset and low-frequency noise
-void applyHighPassFilter(short* audio_data, unsigned long frame_count, float& prev_input, float& prev_output) {
-    const float alpha = 0.95f; // High-pass filter coefficient
-    
-    for (unsigned long i = 0; i < frame_count; ++i) {
-        float input = static_cast<float>(audio_data[i]);
-        float output = alpha * (prev_output + input - prev_input);
-        prev_input = input;
-        prev_output = output;
-        
-        // Clamp to 16-bit range
-        audio_data[i] = static_cast<short>(std::max(-32768.0f, std::min(32767.0f, output)));
+// Audio captured but not decoded yet, queued or spilled
+double backlogSeconds(const VoiceStream& stream) {
+    return (stream.queue.size() + stream.spill.size()) * (double)FRAMES_PER_BUFFER / SAMPLE_RATE;
+}
+
+// Switches between low-latency decoding and catch-up mode as the backlog
+// crosses the thresholds. Catching up, chunks are only released when full
+// or at the end of an utterance: gated silence no longer flushes them.
+void updateCatchUp(VoiceStream& stream) {
+    size_t backlog = stream.queue.size() + stream.spill.size();
+    CatchUpTracker::Change change = stream.catch_up.update(backlog);
+    if (change == CatchUpTracker::Change::ENTERED) {
+        stream.coalescer.setChunkFrames(SAMPLE_RATE * CATCHUP_CHUNK_MS / 1000);
+        stream.coalescer.setMaxDelayFrames(0);
+        std::cout << "[Catch-up] " << std::fixed << std::setprecision(1)
+                  << backlog * (double)FRAMES_PER_BUFFER / SAMPLE_RATE
+                  << " s behind; partials paused, " << CATCHUP_CHUNK_MS << " ms chunks" << std::endl;
+    } else if (change == CatchUpTracker::Change::LEFT) {
+        if (!stream.coalescer.empty()) {
+            decodeChunk(stream);
+        }
+        stream.coalescer.setChunkFrames(THROUGHPUT_MODE ? SAMPLE_RATE * COALESCE_MS / 1000 : 1);
+        stream.coalescer.setMaxDelayFrames(SAMPLE_RATE * COALESCE_MAX_DELAY_MS / 1000);
+        double audio_seconds = stream.catch_up.episodeFrames() / (double)SAMPLE_RATE;
+        double seconds = stream.catch_up.episodeSeconds();
+        std::cout << "[Catch-up] done: " << std::fixed << std::setprecision(1) << audio_seconds
+                  << " s of audio decoded in " << seconds << " s ("
+                  << (seconds > 0.0 ? audio_seconds / seconds : 0.0) << "x real time)" << std::endl;
     }
 }
 
-// Automatic Gain Control
-void applyAGC(short* audio_data, unsigned long frame_count) {
-    // Calculate current audio level
-    double current_level = 0.0;
-    for (unsigned long i = 0; i < frame_count; ++i) {
-        current_level += abs(audio_data[i]);
+// Next block in capture order: from the queue or, if older, the spill file.
+// The queue is checked first: a block the callback queued was spilled
+// after any older block, so the spill file is then up to date.
+bool nextBlock(VoiceStream& stream, AudioBlockRef& block, bool& from_spill) {
+    size_t backlog = stream.queue.size() + stream.spill.size();
+    if (backlog > stream.max_backlog_blocks) {
+        stream.max_backlog_blocks = backlog;
     }
-    current_level /= frame_count;
-    
-    // Adjust gain gradually
-    float current_gain = g_current_gain.load();
-    if (current_level > 0) {
-        float desired_gain = AGC_TARGET_LEVEL / current_level;
-        float new_gain = current_gain + (desired_gain - current_gain) * AGC_ADJUSTMENT_RATE;
-        
-        // Limit gain range
-        new_gain = std::max(0.1f, std::min(10.0f, new_gain));
-        g_current_gain.store(new_gain);
-        
-        // Apply gain
-        for (unsigned long i = 0; i < frame_count; ++i) {
-            float sample = audio_data[i] * new_gain;
-            audio_data[i] = static_cast<short>(std::max(-32768.0f, std::min(32767.0f, sample)));
-        }
+    uint64_t queued_sequence = 0, spilled_sequence = 0;
+    bool queued = stream.queue.frontSequence(queued_sequence);
+    bool spilled = stream.spill.frontSequence(spilled_sequence);
+    from_spill = spilled && (!queued || spilled_sequence < queued_sequence);
+    if (!from_spill) {
+        return stream.queue.pop(block);
     }
+    block = stream.pool.allocate();
+    if (!block) {
+        return false;
+    }
+    AudioBlock *b = block.mutableBlock();
+    return stream.spill.read(b->samples, b->frames, b->result, b->sequence);
 }
 
-// Audio preprocessing function
-void preprocessAudio(short* audio_data, unsigned long frame_count) {
-    static float prev_input = 0.0f, prev_output = 0.0f;
-    
-    // Apply high-pass filter
-    applyHighPassFilter(audio_data, frame_count, prev_input, prev_output);
-    
-    // Apply automatic gain control
-    applyAGC(audio_data, frame_count);
+// Decoder thread: runs Vosk on the blocks the callback queued or spilled
+void decoderThread(VoiceStream* stream) {
+    ThreadRtConfig rt;
+    rt.policy = RT_POLICY;
+    rt.priority = RT_DECODER_PRIORITY;
+    rt.cpu = RT_DECODER_CPU;
+    applyThreadRtConfig(rt, "decoder");
+    if (RT_LOCK_MEMORY) {
+        prefaultStack(RT_PREFAULT_STACK_KB * 1024);
+    }
+
+    AudioBlockRef block;
+    bool from_spill = false;
+    unsigned long spill_reads = 0;
+    bool spill_trim = !RT_LOCK_MEMORY;   // mlockall keeps the spill file resident
+    while (true) {
+        stream->queue.wait();
+        stream->decoder_wakeups++;
+        stream->idle.noteDecoderWakeup();
+        while (nextBlock(*stream, block, from_spill)) {
+            updateCatchUp(*stream);
+            decodeBlock(*stream, block);
+            block.reset();
+            // Keep the spill file's pages out of RSS while draining it
+            if (spill_trim && from_spill && ++spill_reads % SPILL_TRIM_BLOCKS == 0 &&
+                !stream->spill.trimResident()) {
+                std::cerr << "WARNING: Cannot trim the spill file (" << strerror(errno)
+                          << "); it stays resident." << std::endl;
+                spill_trim = false;
+            }
+        }
+        if (stream->decoder_stop.load(std::memory_order_acquire)) {
+            break; // Queue drained
+        }
+        // Nothing is queued while idle, so do not leave a chunk waiting
+        if (stream->idle.idle() && !stream->coalescer.empty()) {
+            decodeChunk(*stream);
+        }
+    }
 }
 
-// Enhanced PortAudio callback with audio preprocessing
+// Enhanced PortAudio callback with audio preprocessing. Vosk runs on the
+// decoder thread, so the callback never waits on the recognizer.
 static int paCallback(const void *inputBuffer, void *outputBuffer,
                       unsigned long framesPerBuffer,
                       const PaStreamCallbackTimeInfo* timeInfo,
                       PaStreamCallbackFlags statusFlags,
                       void *userData) {
-    VoskRecognizer *recognizer = (VoskRecognizer*)userData;
+    VoiceStream *stream = (VoiceStream*)userData;
     const short *input_audio = (const short*)inputBuffer;
 
+    // PortAudio owns this thread; configure it on the first call
+    if (!stream->capture_rt_applied) {
+        ThreadRtConfig rt;
+        rt.policy = RT_POLICY;
+        rt.priority = RT_CAPTURE_PRIORITY;
+        rt.cpu = RT_CAPTURE_CPU;
+        applyThreadRtConfig(rt, "capture");
+        stream->capture_rt_applied = true;
+    }
+    stream->callback_jitter.record();
+    if (statusFlags & paInputOverflow) {
+        stream->input_overflows++;
+    }
+
     if (g_request_stop) {
         return paComplete;
     }
 
-    if (inputBuffer == NULL) {
+    if (inputBuffer == NULL || framesPerBuffer > FRAMES_PER_BUFFER) {
         return paContinue;
     }
 
-    // Copy audio data for processing
-    std::vector<short> audio_data(input_audio, input_audio + framesPerBuffer);
-    
-    // Apply noise gate
-    if (!isAudioAboveNoiseGate(audio_data.data(), framesPerBuffer)) {
-        return paContinue; // Skip processing if below noise gate
+    if (stream->vosk_final.exchange(false, std::memory_order_acq_rel)) {
+        stream->dsp.endpointer.onFinal();
     }
-    
-    // Preprocess audio
-    preprocessAudio(audio_data.data(), framesPerBuffer);
-    
-    // Add to circular buffer for smoothing
-    g_audio_buffer.push(audio_data.data(), framesPerBuffer);
-    
-    // Get smoothed audio data
-    std::vector<short> smoothed_audio = g_audio_buffer.getSmoothed(framesPerBuffer);
-    if (smoothed_audio.empty()) {
-        smoothed_audio = audio_data; // Use original if not enough data for smoothing
+    // Idle: a decimated energy check, and the block is skipped unless it
+    // may be speech. The filter history is from before the idle period.
+    if (stream->idle.idle()) {
+        if (!stream->idle.listen(input_audio, framesPerBuffer)) {
+            stream->captured_blocks++;
+            return paContinue;
+        }
+        stream->dsp.restartFilter(input_audio[0]);
     }
-    
-    // Feed processed audio to Vosk
-    int vosk_status = vosk_recognizer_accept_waveform_s(recognizer, smoothed_audio.data(), smoothed_audio.size());
 
-    if (vosk_status == 0) { // Partial result
-        const char* partial_json_cstr = vosk_recognizer_partial_result(recognizer);
-        if (partial_json_cstr && strlen(partial_json_cstr) > 0) {
-            std::string current_partial_json(partial_json_cstr);
-            
-            // Enhanced filtering for partial results
-            if (current_partial_json.find("\"partial\" : \"\"") == std::string::npos &&
-                current_partial_json != g_last_partial_result_json &&
-                current_partial_json.length() > 20) { // Only show substantial partials
-                
-                std::cout << "Partial: " << current_partial_json << std::endl;
-                g_last_partial_result_json = current_partial_json;
-            }
-        }
-    } else if (vosk_status > 0) { // Final result
-        const char* final_result_json_cstr = vosk_recognizer_result(recognizer);
-        if (final_result_json_cstr && strlen(final_result_json_cstr) > 0) {
-            std::string final_result(final_result_json_cstr);
-            
-            // Only show non-empty final results
-            if (final_result.find("\"text\" : \"\"") == std::string::npos) {
-                std::cout << "Final:   " << final_result << std::endl;
-            }
+    // Past the high-water mark, blocks go to the spill file until the
+    // decoder has drained it, so they reach the decoder in capture order
+    if (stream->spill.isOpen()) {
+        size_t queued = stream->queue.size();
+        if (!stream->spilling && queued >= SPILL_HIGH_WATER_BLOCKS) {
+            stream->spilling = true;
+        } else if (stream->spilling && stream->spill.size() == 0 && queued < SPILL_HIGH_WATER_BLOCKS) {
+            stream->spilling = false;
         }
-        g_last_partial_result_json.clear();
     }
 
+    // Preprocess straight into a pool block or spill record; if neither is
+    // free, the block still goes through the DSP chain so its state stays
+    // continuous
+    AudioBlockRef block;
+    short *spill_record = nullptr;
+    if (stream->spilling) {
+        spill_record = stream->spill.beginWrite();
+    } else if (stream->queue.hasSpace()) {
+        block = stream->pool.allocate();
+    }
+    short *audio_data = spill_record ? spill_record
+                      : block ? block.mutableBlock()->samples : stream->block.data();
+    std::copy(input_audio, input_audio + framesPerBuffer, audio_data);
+
+    // Noise gate, high-pass filter and AGC, in place
+    BlockResult block_result = preprocessBlock(stream->dsp, audio_data, framesPerBuffer);
+    // Before the block is queued, so the decoder sees the idle state once
+    // it has decoded it
+    stream->idle.onBlock(block_result, stream->dsp.endpointer.inUtterance(), framesPerBuffer);
+
+    if (spill_record) {
+        stream->spill.commitWrite(stream->captured_blocks, framesPerBuffer, block_result);
+        stream->queue.wake();
+    } else if (block) {
+        AudioBlock *b = block.mutableBlock();
+        b->frames = framesPerBuffer;
+        b->result = block_result;
+        b->sequence = stream->captured_blocks;
+        stream->queue.push(block);
+    } else {
+        stream->queue.noteDropped();
+    }
+    stream->captured_blocks++;
+
+    // Tell the main loop once the decoder is a second behind; it polls the
+    // backlog from then on
+    size_t backlog = stream->queue.size() + stream->spill.size();
+    if (backlog >= SAMPLE_RATE / FRAMES_PER_BUFFER) {
+        if (!stream->backlog_signalled) {
+            stream->backlog_signalled = true;
+            g_main_event.notify();
+        }
+    } else {
+        stream->backlog_signalled = false;
+    }
     return paContinue;
 }
 
+// Stops the decoder thread after it drained the queue
+void stopDecoder(VoiceStream& stream, std::thread& decoder) {
+    stream.decoder_stop.store(true, std::memory_order_release);
+    stream.queue.wake();
+    stream.idle.wake();   // closes an open idle period for the report
+    if (decoder.joinable()) {
+        decoder.join();
+    }
+}
+
+// Callback timing and queue health, printed on exit. capture_seconds and
+// capture_cpu_seconds cover the whole capture, to compare idle with active.
+void printCaptureReport(VoiceStream& stream, double capture_seconds, double capture_cpu_seconds) {
+    std::cout << "\n=== Capture report ===" << std::endl;
+    std::cout << "Scheduling: " << schedPolicyName(RT_POLICY);
+    if (RT_POLICY != SCHED_OTHER) {
+        std::cout << " (capture " << RT_CAPTURE_PRIORITY << ", decoder " << RT_DECODER_PRIORITY << ")";
+    }
+    std::cout << ", capture CPU " << RT_CAPTURE_CPU << ", decoder CPU " << RT_DECODER_CPU
+              << ", memory " << (RT_LOCK_MEMORY ? "locked" : "not locked") << std::endl;
+    std::cout << "Input overflows: " << stream.input_overflows
+              << ", blocks dropped (decoder behind): " << stream.queue.droppedBlocks() << std::endl;
+    if (stream.spill.isOpen()) {
+        std::cout << "Spill: " << stream.spill.spilledBlocks() << " blocks ("
+                  << std::fixed << std::setprecision(1) << stream.spill.spilledBlocks() * (double)FRAMES_PER_BUFFER / SAMPLE_RATE
+                  << " s) spilled, max backlog " << stream.max_backlog_blocks * (double)FRAMES_PER_BUFFER / SAMPLE_RATE
+                  << " s" << std::endl;
+    }
+    if (CATCHUP_ENTER_BLOCKS > 0) {
+        std::cout << "Catch-up: " << stream.catch_up.episodes() << " episodes, " << std::fixed << std::setprecision(1)
+                  << stream.catch_up.totalSeconds() << " s total (longest " << stream.catch_up.longestSeconds()
+                  << " s), " << stream.catch_up.totalFrames() / (double)SAMPLE_RATE << " s of audio" << std::endl;
+    }
+    if (IDLE_ENTER_MS > 0) {
+        const IdleStats& idle = stream.idle.getStats();
+        double active_seconds = capture_seconds - idle.seconds;
+        std::cout << "Idle: " << idle.periods << " periods, " << std::fixed << std::setprecision(1) << idle.seconds
+                  << " s (" << (capture_seconds > 0.0 ? 100.0 * idle.seconds / capture_seconds : 0.0)
+                  << "% of capture)" << std::endl;
+        if (idle.seconds > 0.0) {
+            std::cout << "  Wakeups/s while idle: capture callback " << idle.callbacks / idle.seconds
+                      << ", decoder " << idle.decoder_wakeups / idle.seconds
+                      << ", main " << idle.main_wakeups / idle.seconds << std::endl;
+            std::cout << "  CPU: " << std::setprecision(2) << 100.0 * idle.cpu_seconds / idle.seconds
+                      << "% of a core idle, "
+                      << (active_seconds > 0.0 ? 100.0 * (capture_cpu_seconds - idle.cpu_seconds) / active_seconds : 0.0)
+                      << "% active" << std::endl;
+        }
+    }
+    if (capture_seconds > 0.0) {
+        std::cout << "Wakeups/s overall: decoder " << std::fixed << std::setprecision(1)
+                  << stream.decoder_wakeups / capture_seconds << ", main " << g_main_event.wakeups() / capture_seconds
+                  << "; CPU " << std::setprecision(2) << 100.0 * capture_cpu_seconds / capture_seconds
+                  << "% of a core" << std::endl;
+    }
+    std::cout << "Block pool: " << stream.pool.capacity() << " blocks, " << stream.pool.available()
+              << " free, exhausted " << stream.pool.exhaustedCount() << " times" << std::endl;
+    stream.callback_jitter.print(std::cout, "Callback jitter");
+}
+
 // Enhanced quit command checker with better instructions
 void checkForQuitCommand() {
     std::cout << "\n=== VOICE RECOGNITION ACTIVE ===" << std::endl;
@@ -219,7 +563,32 @@ void checkForQuitCommand() {
     std::cout << "  - Noise gate filtering" << std::endl;
     std::cout << "  - Automatic gain control" << std::endl;
     std::cout << "  - High-pass filtering" << std::endl;
-    std::cout << "  - Audio smoothing" << std::endl;
+    std::cout << "  - Recent audio kept by reference (" << RECENT_AUDIO_BLOCKS << " blocks)" << std::endl;
+    if (SPILL_FILE_PATH[0] != '\0') {
+        std::cout << "  - Lossless spill to disk past " << SPILL_HIGH_WATER_BLOCKS << " queued blocks" << std::endl;
+    }
+    std::cout << "  - Partial results: " << partialModeName(PARTIAL_MODE);
+    if (PARTIAL_MODE == PartialMode::TIME || PARTIAL_MODE == PartialMode::CHANGE) {
+        std::cout << " (every " << PARTIAL_INTERVAL_MS << " ms)";
+    }
+    std::cout << std::endl;
+    if (IDLE_ENTER_MS > 0) {
+        std::cout << "  - Low-power idle after " << IDLE_ENTER_MS << " ms of silence" << std::endl;
+    }
+    if (CATCHUP_ENTER_BLOCKS > 0) {
+        std::cout << "  - Catch-up mode past " << CATCHUP_ENTER_BLOCKS << " blocks of backlog" << std::endl;
+    }
+    if (THROUGHPUT_MODE) {
+        std::cout << "  - Throughput mode: " << COALESCE_MS << " ms decoder chunks (max delay "
+                  << COALESCE_MAX_DELAY_MS << " ms)" << std::endl;
+    }
+    if (SILENCE_DETECTION_MS > 0) {
+        std::cout << "  - Endpointing after " << SILENCE_DETECTION_MS << " ms of silence" << std::endl;
+    }
+    if (RT_POLICY != SCHED_OTHER || RT_CAPTURE_CPU >= 0 || RT_DECODER_CPU >= 0) {
+        std::cout << "  - Real-time threads: " << schedPolicyName(RT_POLICY)
+                  << ", capture CPU " << RT_CAPTURE_CPU << ", decoder CPU " << RT_DECODER_CPU << std::endl;
+    }
     std::cout << "\nTips for better recognition:" << std::endl;
     std::cout << "  - Speak clearly and at moderate pace" << std::endl;
     std::cout << "  - Keep consistent distance from microphone" << std::endl;
@@ -230,6 +599,7 @@ void checkForQuitCommand() {
     while (std::cin.get(c)) {
         if (c == 'q' || c == 'Q') {
             g_request_stop = true;
+            g_main_event.notify();
             break;
         }
         if (c == '\n' && g_request_stop) {
@@ -240,9 +610,21 @@ void checkForQuitCommand() {
 
 int main() {
     std::cout << "=== Enhanced Vosk Speech Recognition ===" << std::endl;
+
+    // 0. Lock memory before the model loads, so the model stays resident too
+    if (RT_LOCK_MEMORY &&
+        lockAndPrefaultMemory(RT_PREFAULT_STACK_KB * 1024, (size_t)RT_PREFAULT_HEAP_MB * 1024 * 1024)) {
+        std::cout << "✓ Memory locked (" << RT_PREFAULT_HEAP_MB << " MB heap prefaulted)." << std::endl;
+    }
     
-    // 1. Initialize Vosk Model
+    // 1. Initialize Vosk Model, prefetching its files alongside
+    ModelPrefetcher prefetcher;
+    if (MODEL_PREFETCH_THREADS > 0) prefetcher.start(MODEL_PATH, MODEL_PREFETCH_MODE, MODEL_PREFETCH_THREADS);
+    auto model_load_start = std::chrono::steady_clock::now();
     VoskModel *model = vosk_model_new(MODEL_PATH);
+    auto model_load_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - model_load_start).count();
+    prefetcher.wait();
     if (!model) {
         std::cerr << "ERROR: Failed to load Vosk model from \"" << MODEL_PATH << "\"" << std::endl;
         std::cerr << "Please ensure the path is correct and model files are present." << std::endl;
@@ -252,7 +634,13 @@ int main() {
         std::cerr << "  - vosk-model-en-us-daanzu-20200905 (1GB+) - best quality" << std::endl;
         return 1;
     }
-    std::cout << "✓ Vosk model loaded successfully." << std::endl;
+    std::cout << "✓ Vosk model loaded successfully (" << model_load_ms << " ms)." << std::endl;
+    if (MODEL_PREFETCH_THREADS > 0) {
+        const PrefetchReport& prefetch = prefetcher.getReport();
+        std::cout << "✓ Prefetched " << prefetch.files << " model files (" << prefetch.bytes / (1024 * 1024)
+                  << " MB, " << prefetchModeName(MODEL_PREFETCH_MODE) << ", " << MODEL_PREFETCH_THREADS
+                  << " threads) in " << (long)prefetch.prefetch_ms << " ms." << std::endl;
+    }
 
     // 2. Create Vosk Recognizer with enhanced settings
     VoskRecognizer *recognizer = vosk_recognizer_new(model, (float)SAMPLE_RATE);
@@ -264,9 +652,56 @@ int main() {
     
     // Enable word-level timestamps and confidence scores
     vosk_recognizer_set_words(recognizer, 1);
+    // Word times in partials let keyword alerts carry timestamps
+    vosk_recognizer_set_partial_words(recognizer, 1);
     
     std::cout << "✓ Vosk recognizer created with word-level timestamps." << std::endl;
 
+    if (WARMUP_SECONDS > 0) {
+        double warmup_ms = warmUpRecognizer(recognizer, generateWarmupAudio(WARMUP_SECONDS, SAMPLE_RATE));
+        std::cout << "✓ Recognizer warmed up (" << WARMUP_SECONDS << " s of synthetic audio in "
+                  << (long)warmup_ms << " ms)." << std::endl;
+    }
+
+    StreamDspConfig dsp_config;
+    dsp_config.gate_threshold = NOISE_GATE_THRESHOLD;
+    dsp_config.agc_target_level = AGC_TARGET_LEVEL;
+    dsp_config.agc_adjustment_rate = AGC_ADJUSTMENT_RATE;
+    dsp_config.silence_ms = SILENCE_DETECTION_MS;
+    dsp_config.sample_rate = SAMPLE_RATE;
+    VoiceStream stream(recognizer, dsp_config);
+
+    // Transcript store is optional; recognition continues without it
+    if (g_transcript_store.open(TRANSCRIPT_STORE_DIR)) {
+        std::cout << "✓ Transcript store opened at \"" << TRANSCRIPT_STORE_DIR << "\" ("
+                  << g_transcript_store.wordCount() << " words stored)." << std::endl;
+    } else {
+        std::cerr << "WARNING: Transcripts will not be stored." << std::endl;
+    }
+
+    // Spill file is optional; without it blocks are dropped when the decoder
+    // falls behind
+    if (SPILL_FILE_PATH[0] != '\0') {
+        size_t spill_records = (size_t)SPILL_MAX_SECONDS * SAMPLE_RATE / FRAMES_PER_BUFFER;
+        if (stream.spill.open(SPILL_FILE_PATH, spill_records, FRAMES_PER_BUFFER, SPILL_PREFAULT_BLOCKS)) {
+            std::cout << "✓ Spill file ready (" << SPILL_MAX_SECONDS << " s of audio past "
+                      << SPILL_HIGH_WATER_BLOCKS << " queued blocks)." << std::endl;
+        } else {
+            std::cerr << "WARNING: Cannot create spill file \"" << SPILL_FILE_PATH
+                      << "\"; blocks will be dropped if the decoder falls behind." << std::endl;
+        }
+    }
+
+    // Keyword watch list is optional
+    if (g_keyword_automaton.loadFile(KEYWORD_WATCH_LIST)) {
+        auto compile_start = std::chrono::steady_clock::now();
+        g_keyword_automaton.compile();
+        auto compile_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - compile_start).count();
+        std::cout << "✓ Keyword alerts armed: " << g_keyword_automaton.phraseCount() << " phrases, "
+                  << g_keyword_automaton.stateCount() << " states (" << compile_ms << " ms)." << std::endl;
+    }
+
     // 3. Initialize PortAudio
     PaError pa_err = Pa_Initialize();
     if (pa_err != paNoError) {
@@ -303,7 +738,7 @@ int main() {
                  FRAMES_PER_BUFFER,
                  paClipOff,
                  paCallback,
-                 recognizer);
+                 &stream);
 
     if (pa_err != paNoError) {
         std::cerr << "PortAudio ERROR: Pa_OpenStream returned: " << Pa_GetErrorText(pa_err) << std::endl;
@@ -313,10 +748,19 @@ int main() {
         return 1;
     }
 
-    // 6. Start PortAudio Stream
+    // 6. Start the decoder thread and the PortAudio Stream
+    std::thread decoder_thread(decoderThread, &stream);
+    stream.callback_jitter.start((uint64_t)FRAMES_PER_BUFFER * 1000000000ull / SAMPLE_RATE);
+    stream.timeline.start(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count(),
+        SAMPLE_RATE);
+    auto capture_start = std::chrono::steady_clock::now();
+    double capture_cpu_start = processCpuSeconds();
     pa_err = Pa_StartStream(pa_stream);
     if (pa_err != paNoError) {
         std::cerr << "PortAudio ERROR: Pa_StartStream returned: " << Pa_GetErrorText(pa_err) << std::endl;
+        stopDecoder(stream, decoder_thread);
         Pa_CloseStream(pa_stream);
         Pa_Terminate();
         vosk_recognizer_free(recognizer);
@@ -334,21 +778,41 @@ int main() {
     // 7. Start quit checker thread
     std::thread quit_checker_thread(checkForQuitCommand);
 
-    // 8. Main loop with status monitoring
+    // 8. Main loop with status monitoring. Event driven: it sleeps until the
+    // next status line, a quit or the decoder falling behind
     auto last_status_time = std::chrono::steady_clock::now();
+    auto last_backlog_time = last_status_time;
+    uint32_t seen_event = g_main_event.current();
     while (!g_request_stop) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto next_due = last_status_time + std::chrono::seconds(30);
+        if (backlogSeconds(stream) >= 1.0) {
+            next_due = std::min(next_due, last_backlog_time + std::chrono::seconds(1));
+        }
+        long timeout_ms = std::chrono::ceil<std::chrono::milliseconds>(
+            next_due - std::chrono::steady_clock::now()).count();
+        g_main_event.wait(seen_event, std::max(0L, timeout_ms));
+        seen_event = g_main_event.current();
+        stream.idle.noteMainWakeup();
         
         // Optional: Print status every 30 seconds
         auto now = std::chrono::steady_clock::now();
-        if (std::chrono::duration_cast<std::chrono::seconds>(now - last_status_time).count() >= 30) {
+        // Backlog once a second while the decoder is more than a second behind
+        double backlog = backlogSeconds(stream);
+        if (backlog >= 1.0 && now - last_backlog_time >= std::chrono::seconds(1)) {
+            std::cout << "[Backlog] " << std::fixed << std::setprecision(1) << backlog << " s behind"
+                      << (stream.spill.size() > 0 ? " (spilling to disk)" : "") << std::endl;
+            last_backlog_time = now;
+        }
+        if (now - last_status_time >= std::chrono::seconds(30)) {
             std::cout << "[Status] Recognition active. Current gain: " 
-                      << std::fixed << std::setprecision(2) << g_current_gain.load() << std::endl;
+                      << std::fixed << std::setprecision(2) << stream.dsp.published_gain.load() << std::endl;
             last_status_time = now;
         }
     }
 
     std::cout << "\n'q' pressed. Shutting down gracefully..." << std::endl;
+    double capture_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - capture_start).count();
+    double capture_cpu_seconds = processCpuSeconds() - capture_cpu_start;
 
     // Wait for input thread
     if (quit_checker_thread.joinable()) {
@@ -370,15 +834,13 @@ int main() {
     Pa_Terminate();
     std::cout << "✓ PortAudio terminated." << std::endl;
 
-    // 11. Get final result
-    const char* final_buffered_result_json = vosk_recognizer_final_result(recognizer);
-    if (final_buffered_result_json && strlen(final_buffered_result_json) > 0) {
-        if (std::string(final_buffered_result_json).find("\"text\" : \"\"") == std::string::npos) {
-            std::cout << "Final (on exit): " << final_buffered_result_json << std::endl;
-        }
-    }
+    // 11. Drain the decoder and get the final result
+    stopDecoder(stream, decoder_thread);
+    endUtterance(stream, "Final (on exit): ");
+    printCaptureReport(stream, capture_seconds, capture_cpu_seconds);
 
     // 12. Clean up
+    g_transcript_store.close();
     vosk_recognizer_free(recognizer);
     vosk_model_free(model);
     std::cout << "✓ All resources freed. Program terminated successfully." << std::endl;
@@ -0,0 +1,201 @@
+// Helpers for reading the JSON returned by vosk_recognizer_result(),
+// vosk_recognizer_partial_result() and vosk_recognizer_final_result(),
+// and for mapping the word times in it back to capture time.
+//
+// Vosk emits a small, fixed JSON shape, so a full JSON library is not
+// needed here:
+//
+//   {
+//     "result" : [{ "conf" : 1.000000, "end" : 1.110000, "start" : 0.870000, "word" : "what" }, ...],
+//     "text" : "what zero zero zero one"
+//   }
+//
+// Partial results use "partial" for the text and, when
+// vosk_recognizer_set_partial_words() is enabled, "partial_result" for the
+// word list.
+
+#ifndef VOSK_RESULT_H
+#define VOSK_RESULT_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct VoskWord {
+    std::string word;
+    double start = 0.0;  // seconds, relative to the recognizer's first sample
+    double end = 0.0;
+    float conf = 1.0f;
+};
+
+namespace vosk_result_detail {
+
+inline const char* skipSpace(const char* p) {
+    while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t') ++p;
+    return p;
+}
+
+// Parses a JSON string starting at the opening quote. Returns the position
+// after the closing quote, or nullptr on malformed input.
+inline const char* parseString(const char* p, std::string& out) {
+    if (*p != '"') return nullptr;
+    ++p;
+    out.clear();
+    while (*p && *p != '"') {
+        if (*p == '\\' && p[1]) {
+            ++p;
+            switch (*p) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    // Vosk writes UTF-8 directly; \u escapes only appear for
+                    // control characters, which are of no use in a transcript.
+                    for (int i = 0; i < 4 && p[1]; ++i) ++p;
+                    break;
+                }
+                default: out += *p; break;
+            }
+            ++p;
+        } else {
+            out += *p++;
+        }
+    }
+    return *p == '"' ? p + 1 : nullptr;
+}
+
+// Returns the position just after `"key" :`, or nullptr if the key is absent.
+inline const char* findKey(const char* json, const char* key) {
+    std::string needle = std::string("\"") + key + "\"";
+    const char* p = json;
+    while ((p = strstr(p, needle.c_str())) != nullptr) {
+        const char* q = skipSpace(p + needle.size());
+        if (*q == ':') return skipSpace(q + 1);
+        p += needle.size();
+    }
+    return nullptr;
+}
+
+} // namespace vosk_result_detail
+
+// Extracts a top-level string field such as "text" or "partial".
+inline std::string parseVoskText(const char* json, const char* key) {
+    std::string text;
+    if (!json) return text;
+    const char* p = vosk_result_detail::findKey(json, key);
+    if (!p || !vosk_result_detail::parseString(p, text)) text.clear();
+    return text;
+}
+
+// Extracts the word array stored under `key` ("result" for final results,
+// "partial_result" for partials). Returns false if the array is missing,
+// e.g. when word output is disabled on the recognizer.
+inline bool parseVoskWords(const char* json, const char* key, std::vector<VoskWord>& words) {
+    using namespace vosk_result_detail;
+    words.clear();
+    if (!json) return false;
+    const char* p = findKey(json, key);
+    if (!p || *p != '[') return false;
+    p = skipSpace(p + 1);
+
+    std::string name, value;
+    while (*p == '{') {
+        VoskWord w;
+        p = skipSpace(p + 1);
+        while (*p == '"') {
+            p = parseString(p, name);
+            if (!p) return false;
+            p = skipSpace(p);
+            if (*p != ':') return false;
+            p = skipSpace(p + 1);
+            if (*p == '"') {
+                p = parseString(p, value);
+                if (!p) return false;
+                if (name == "word") w.word = value;
+            } else {
+                char* num_end = nullptr;
+                double v = strtod(p, &num_end);   // a float steps past 1 ms after ~2 h of fed audio
+                if (num_end == p) return false;
+                p = num_end;
+                if (name == "start") w.start = v;
+                else if (name == "end") w.end = v;
+                else if (name == "conf") w.conf = (float)v;
+            }
+            p = skipSpace(p);
+            if (*p == ',') p = skipSpace(p + 1);
+        }
+        if (*p != '}') return false;
+        words.push_back(std::move(w));
+        p = skipSpace(p + 1);
+        if (*p == ',') p = skipSpace(p + 1);
+    }
+    return *p == ']';
+}
+
+// Maps recognizer time back to capture time. The noise gate drops blocks
+// before they reach Vosk, so the recognizer's clock only advances while
+// audio is being fed and drifts behind the wall clock after every pause.
+// The timeline remembers where each contiguous fed run started in the
+// captured stream so word times can be converted to epoch milliseconds.
+class StreamTimeline {
+private:
+    // (fed sample, captured sample) at the start of every fed run
+    std::vector<std::pair<uint64_t, uint64_t>> runs;
+    uint64_t fed_samples = 0;
+    uint64_t captured_samples = 0;
+    bool feeding = false;
+    int64_t start_epoch_ms = 0;
+    int sample_rate = 16000;
+
+public:
+    void start(int64_t epoch_ms, int rate) {
+        runs.clear();
+        fed_samples = captured_samples = 0;
+        feeding = false;
+        start_epoch_ms = epoch_ms;
+        sample_rate = rate;
+    }
+
+    // Call once per captured block, whether or not it reached the recognizer.
+    void onBlock(size_t frames, bool fed_to_recognizer) {
+        if (fed_to_recognizer) {
+            if (!feeding) runs.emplace_back(fed_samples, captured_samples);
+            fed_samples += frames;
+        }
+        feeding = fed_to_recognizer;
+        captured_samples += frames;
+    }
+
+    // Call after vosk_recognizer_reset(); the recognizer clock restarts at 0.
+    void onRecognizerReset() {
+        runs.clear();
+        fed_samples = 0;
+        feeding = false;
+    }
+
+    int64_t toEpochMs(double recognizer_seconds) const {
+        uint64_t fed = static_cast<uint64_t>(recognizer_seconds * sample_rate + 0.5);
+        uint64_t captured = fed;
+        // Runs are sorted by fed position; find the last one starting at or before `fed`.
+        for (size_t i = runs.size(); i-- > 0;) {
+            if (runs[i].first <= fed) {
+                captured = runs[i].second + (fed - runs[i].first);
+                break;
+            }
+        }
+        return start_epoch_ms + static_cast<int64_t>(captured * 1000 / sample_rate);
+    }
+
+    // Drops runs that end before `recognizer_seconds`; call after each final
+    // result so the table does not grow over long sessions.
+    void forgetBefore(double recognizer_seconds) {
+        uint64_t fed = static_cast<uint64_t>(recognizer_seconds * sample_rate);
+        size_t keep = 0;
+        while (keep + 1 < runs.size() && runs[keep + 1].first <= fed) ++keep;
+        if (keep > 0) runs.erase(runs.begin(), runs.begin() + keep);
+    }
+};
+
+#endif // VOSK_RESULT_H
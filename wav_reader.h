@@ -0,0 +1,61 @@
+// Minimal WAV reader for replaying recordings through the recognizer.
+// Only 16-bit PCM mono files are accepted, which is what Vosk consumes.
+
+#ifndef WAV_READER_H
+#define WAV_READER_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+inline bool readWavFile(const std::string& path, std::vector<short>& samples, int& sample_rate) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "ERROR: Cannot open \"" << path << "\"" << std::endl;
+        return false;
+    }
+
+    char riff[12];
+    if (!in.read(riff, sizeof(riff)) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        std::cerr << "ERROR: \"" << path << "\" is not a WAV file." << std::endl;
+        return false;
+    }
+
+    bool have_format = false;
+    char chunk_id[4];
+    uint32_t chunk_size = 0;
+    while (in.read(chunk_id, 4) && in.read(reinterpret_cast<char*>(&chunk_size), 4)) {
+        if (memcmp(chunk_id, "fmt ", 4) == 0) {
+            uint16_t format = 0, channels = 0, bits = 0;
+            uint32_t rate = 0;
+            char fmt[16];
+            if (chunk_size < sizeof(fmt) || !in.read(fmt, sizeof(fmt))) break;
+            memcpy(&format, fmt, 2);
+            memcpy(&channels, fmt + 2, 2);
+            memcpy(&rate, fmt + 4, 4);
+            memcpy(&bits, fmt + 14, 2);
+            if (format != 1 || channels != 1 || bits != 16) {
+                std::cerr << "ERROR: \"" << path << "\" must be 16-bit PCM mono." << std::endl;
+                return false;
+            }
+            sample_rate = static_cast<int>(rate);
+            have_format = true;
+            in.seekg(chunk_size - sizeof(fmt) + (chunk_size & 1), std::ios::cur);
+        } else if (memcmp(chunk_id, "data", 4) == 0) {
+            if (!have_format) break;
+            samples.resize(chunk_size / sizeof(short));
+            in.read(reinterpret_cast<char*>(samples.data()), samples.size() * sizeof(short));
+            samples.resize(in.gcount() / sizeof(short));
+            return true;
+        } else {
+            in.seekg(chunk_size + (chunk_size & 1), std::ios::cur);
+        }
+    }
+    std::cerr << "ERROR: \"" << path << "\" has no PCM data." << std::endl;
+    return false;
+}
+
+#endif // WAV_READER_H